@@ -0,0 +1,85 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "FrameArena.h"
+#include <algorithm>
+#include <cassert>
+
+FrameArena::FrameArena(std::size_t capacity)
+    : blocks_{},
+    block_{0},
+    used_{0}
+{
+    blocks_.reserve(8);
+    blocks_.push_back(Block{std::unique_ptr<char[]>(new char[capacity]),
+                            capacity});
+}
+
+void FrameArena::reset()
+{
+    // Everything that overflowed into extra blocks fits in one next time.
+    if (blocks_.size() > 1) {
+        std::size_t total = 0;
+        for (const auto &b : blocks_) {
+            total += b.size;
+        }
+        blocks_.clear();
+        blocks_.push_back(Block{std::unique_ptr<char[]>(new char[total]),
+                                total});
+    }
+    block_ = 0;
+    used_ = 0;
+}
+
+std::size_t FrameArena::capacity() const
+{
+    std::size_t total = 0;
+    for (const auto &b : blocks_) {
+        total += b.size;
+    }
+    return total;
+}
+
+void * FrameArena::allocBytes(std::size_t size, std::size_t align)
+{
+    for (;;) {
+        auto &b = blocks_[block_];
+        const auto start = (used_ + align - 1) / align * align;
+        if (start + size <= b.size) {
+            used_ = start + size;
+            return b.data.get() + start;
+        }
+
+        // Move on to the next block, adding one if this was the last.
+        ++block_;
+        used_ = 0;
+        if (block_ == blocks_.size()) {
+            const auto newSize = std::max(size + align, b.size * 2);
+            blocks_.push_back(Block{std::unique_ptr<char[]>(new char[newSize]),
+                                    newSize});
+        }
+    }
+}
+
+FrameArena::Scope::Scope(FrameArena &arena)
+    : arena_(arena),
+    block_{arena.block_},
+    used_{arena.used_}
+{
+}
+
+FrameArena::Scope::~Scope()
+{
+    assert(arena_.block_ >= block_);
+    arena_.block_ = block_;
+    arena_.used_ = used_;
+}
@@ -0,0 +1,82 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for temporaries that only live until the end of a frame or
+// a single call.  Memory is handed out in order and given back all at once.
+// When a block fills up, another one is allocated, and the next reset()
+// replaces them with a single block big enough for everything, so once the
+// arena has seen the busiest frame it never allocates again.
+class FrameArena
+{
+public:
+    explicit FrameArena(std::size_t capacity = 64 * 1024);
+
+    FrameArena(const FrameArena &) = delete;
+    FrameArena & operator=(const FrameArena &) = delete;
+
+    // Uninitialized space for n objects.  Only for types that don't need
+    // destructors, since nothing here will call them.
+    template <typename T>
+    T * alloc(std::size_t n);
+
+    // Give back everything allocated so far.
+    void reset();
+
+    // Everything allocated after a mark is given back when the scope ends.
+    class Scope
+    {
+    public:
+        explicit Scope(FrameArena &arena);
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope & operator=(const Scope &) = delete;
+
+    private:
+        FrameArena &arena_;
+        std::size_t block_;
+        std::size_t used_;
+    };
+
+    std::size_t capacity() const;
+
+private:
+    void * allocBytes(std::size_t size, std::size_t align);
+
+    struct Block
+    {
+        std::unique_ptr<char[]> data;
+        std::size_t size;
+    };
+
+    std::vector<Block> blocks_;
+    std::size_t block_;  // block currently being handed out
+    std::size_t used_;  // bytes used in that block
+};
+
+template <typename T>
+T * FrameArena::alloc(std::size_t n)
+{
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "FrameArena never runs destructors");
+    return static_cast<T *>(allocBytes(n * sizeof(T), alignof(T)));
+}
+
+#endif
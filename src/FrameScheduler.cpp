@@ -0,0 +1,153 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "FrameScheduler.h"
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+    const int historySize = 120;
+
+    // How long to sleep when idle before checking in again.
+    const int idleTimeoutMs = 1000;
+
+    // After a long stall, don't try to simulate more than this many steps to
+    // catch up.  Drop the missed time instead.
+    const int maxStepsPerCall = 5;
+}
+
+FrameScheduler::FrameScheduler(int stepsPerSec, int maxFps)
+    : ticksPerSec_{SDL_GetPerformanceFrequency()},
+    stepTicks_{ticksPerSec_ / stepsPerSec},
+    frameTicks_{maxFps > 0 ? ticksPerSec_ / maxFps : 0},
+    lastStep_{SDL_GetPerformanceCounter()},
+    lastFrame_{0},
+    frameStart_{0},
+    intervals_(historySize, 0),
+    drawTimes_(historySize, 0),
+    numFrames_{0}
+{
+    assert(stepsPerSec > 0);
+}
+
+bool FrameScheduler::waitEvent(SDL_Event &event, bool isIdle)
+{
+    if (SDL_PollEvent(&event)) {
+        return true;
+    }
+
+    if (isIdle) {
+        const bool gotEvent = SDL_WaitEventTimeout(&event, idleTimeoutMs) != 0;
+
+        // Time spent asleep doesn't need to be simulated.
+        lastStep_ = SDL_GetPerformanceCounter();
+        return gotEvent;
+    }
+
+    // Sleep until the next step or frame is due, waking early for events.
+    auto nextDue = lastStep_ + stepTicks_;
+    if (frameTicks_ > 0) {
+        nextDue = std::min(nextDue, lastFrame_ + frameTicks_);
+    }
+    const auto now = SDL_GetPerformanceCounter();
+    if (nextDue <= now) {
+        return false;
+    }
+
+    const auto waitMs = static_cast<int>(toMs(nextDue - now));
+    if (waitMs > 0) {
+        return SDL_WaitEventTimeout(&event, waitMs) != 0;
+    }
+    return false;
+}
+
+int FrameScheduler::stepsDue()
+{
+    const auto now = SDL_GetPerformanceCounter();
+    auto steps = static_cast<int>((now - lastStep_) / stepTicks_);
+    if (steps > maxStepsPerCall) {
+        lastStep_ = now;
+        return maxStepsPerCall;
+    }
+
+    lastStep_ += steps * stepTicks_;
+    return steps;
+}
+
+double FrameScheduler::stepSeconds() const
+{
+    return static_cast<double>(stepTicks_) / ticksPerSec_;
+}
+
+bool FrameScheduler::frameDue() const
+{
+    return frameTicks_ == 0 ||
+        SDL_GetPerformanceCounter() - lastFrame_ >= frameTicks_;
+}
+
+void FrameScheduler::beginFrame()
+{
+    frameStart_ = SDL_GetPerformanceCounter();
+    if (lastFrame_ > 0) {
+        intervals_[numFrames_ % historySize] = frameStart_ - lastFrame_;
+    }
+    lastFrame_ = frameStart_;
+}
+
+void FrameScheduler::endFrame()
+{
+    drawTimes_[numFrames_ % historySize] =
+        SDL_GetPerformanceCounter() - frameStart_;
+    ++numFrames_;
+}
+
+FrameStats FrameScheduler::stats() const
+{
+    FrameStats s = {numFrames_, 0.0, 0.0, 0.0, 0.0, 0.0};
+    const int n = std::min(numFrames_, historySize);
+    if (n == 0) {
+        return s;
+    }
+
+    // The first frame has no interval, so skip empty entries.
+    std::vector<Uint64> intervals;
+    Uint64 drawTotal = 0;
+    Uint64 drawMax = 0;
+    for (int i = 0; i < n; ++i) {
+        if (intervals_[i] > 0) {
+            intervals.push_back(intervals_[i]);
+        }
+        drawTotal += drawTimes_[i];
+        drawMax = std::max(drawMax, drawTimes_[i]);
+    }
+    s.avgDraw = toMs(drawTotal) / n;
+    s.maxDraw = toMs(drawMax);
+
+    if (!intervals.empty()) {
+        std::sort(std::begin(intervals), std::end(intervals));
+        Uint64 total = 0;
+        for (auto t : intervals) {
+            total += t;
+        }
+        s.avgInterval = toMs(total) / intervals.size();
+        s.maxInterval = toMs(intervals.back());
+        s.p95Interval = toMs(intervals[intervals.size() * 95 / 100]);
+    }
+
+    return s;
+}
+
+double FrameScheduler::toMs(Uint64 ticks) const
+{
+    return ticks * 1000.0 / ticksPerSec_;
+}
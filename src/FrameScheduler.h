@@ -0,0 +1,72 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include "sdl_utils.h"
+#include <vector>
+
+// Summary of recent frame times, in milliseconds.
+struct FrameStats
+{
+    int frames;
+    double avgInterval;  // time between the start of one frame and the next
+    double maxInterval;
+    double p95Interval;
+    double avgDraw;      // time spent drawing each frame
+    double maxDraw;
+};
+
+
+// Main loop timing.  Simulation runs in fixed-size steps, independent of how
+// often frames are drawn.  Frames are limited to a maximum rate, or paced by
+// vsync if there is no limit.  When there's nothing to do, we sleep until the
+// next event instead of polling.
+class FrameScheduler
+{
+public:
+    // 'maxFps' of 0 means draw as often as the display allows.
+    FrameScheduler(int stepsPerSec, int maxFps);
+
+    // Return true and fill in 'event' if one arrives before the next step or
+    // frame is due.  If the caller is idle, block until an event arrives.
+    bool waitEvent(SDL_Event &event, bool isIdle);
+
+    // Return how many fixed steps to simulate to catch up to real time.
+    int stepsDue();
+    double stepSeconds() const;
+
+    // True if enough time has passed since the last frame was drawn.
+    bool frameDue() const;
+
+    // Bracket the drawing of each frame to collect statistics.
+    void beginFrame();
+    void endFrame();
+
+    FrameStats stats() const;
+
+private:
+    double toMs(Uint64 ticks) const;
+
+    Uint64 ticksPerSec_;
+    Uint64 stepTicks_;
+    Uint64 frameTicks_;
+    Uint64 lastStep_;
+    Uint64 lastFrame_;
+    Uint64 frameStart_;
+    std::vector<Uint64> intervals_;  // ring buffers of recent frames
+    std::vector<Uint64> drawTimes_;
+    int numFrames_;
+};
+
+#endif
@@ -12,26 +12,156 @@
 */
 #include "GameWindow.h"
 #include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+    const int tileSize = 256;
+    const int tileCapacity = 64;
+
+    // Size of the buckets used to find entities under the mouse, in map
+    // pixels.  A bit bigger than a typical sprite.
+    const int pickCellSize = 128;
+    const double minZoom = 0.125;
+    const double maxZoom = 4.0;
+
+    // How long it takes an entity to move from one place to another.
+    const Uint32 moveMs = 250;
+
+    // Past this many separate damaged areas, redraw their bounding box
+    // instead.
+    const int maxDamageRects = 8;
+
+    // Create a texture to draw the scene into, or null if the renderer can't
+    // draw to textures.
+    SdlTexture makeFrameTexture(SdlWindow &win, int width, int height)
+    {
+        auto ren = win.getRenderer();
+        if (!SDL_RenderTargetSupported(ren)) {
+            return {};
+        }
+
+        auto tex = SDL_CreateTexture(ren,
+                                     SDL_PIXELFORMAT_ARGB8888,
+                                     SDL_TEXTUREACCESS_TARGET,
+                                     width,
+                                     height);
+        if (!tex) {
+            std::cerr << "Error creating frame texture: " << SDL_GetError();
+            return {};
+        }
+
+        return {tex, win, width, height};
+    }
+}
 
 GameWindow::GameWindow(int width, int height, const char *title)
     : win_{width, height, title},
-    advMap_{}
+    winWidth_{width},
+    winHeight_{height},
+    frame_{makeFrameTexture(win_, width, height)},
+    damage_(1, SDL_Rect{0, 0, width, height}),
+    mapTiles_{win_, tileSize, tileCapacity},
+    mapWidth_{0},
+    mapHeight_{0},
+    viewX_{0.0},
+    viewY_{0.0},
+    zoom_{1.0},
+    atlas_{win_},
+    entities_{},
+    entityGrid_{},
+    numMoving_{0},
+    hoverEntity_{-1},
+    clock_{SDL_GetTicks}
 {
+    damage_.reserve(maxDamageRects);
 }
 
-SdlSurface GameWindow::getBlankMap() const
+void GameWindow::setClock(Clock clock)
 {
-    return win_.createBlankSurface();
+    clock_ = std::move(clock);
 }
 
-void GameWindow::updateMap(const SdlSurface &surf)
+void GameWindow::setMap(int width, int height, int numLevels,
+                        TileCache::TileRenderer fn)
 {
-    if (!advMap_) {
-        advMap_ = SdlTextureStream{surf, win_};
+    mapWidth_ = width;
+    mapHeight_ = height;
+    mapTiles_.setMap(width, height, numLevels, std::move(fn));
+    entityGrid_ = SpatialGrid{width, height, pickCellSize};
+    for (const auto &e : entities_) {
+        entityGrid_.insert(e.id, entityMapBounds(e));
     }
-    else {
-        advMap_.update(surf);
+    boundViewport();
+    damageAll();
+}
+
+void GameWindow::invalidateMap()
+{
+    mapTiles_.invalidate();
+    damageAll();
+}
+
+void GameWindow::invalidateMap(int level, const SDL_Rect &levelRect)
+{
+    mapTiles_.invalidate(level, levelRect);
+    if (level != mapLevel()) {
+        return;  // not on screen
     }
+
+    const int scale = 1 << level;
+    const int x1 = screenX(levelRect.x * scale);
+    const int y1 = screenY(levelRect.y * scale);
+    const int x2 = screenX((levelRect.x + levelRect.w) * scale);
+    const int y2 = screenY((levelRect.y + levelRect.h) * scale);
+    addDamage({x1, y1, x2 - x1, y2 - y1});
+}
+
+void GameWindow::scroll(int dx, int dy)
+{
+    viewX_ += dx / zoom_;
+    viewY_ += dy / zoom_;
+    boundViewport();
+    damageAll();
+}
+
+void GameWindow::zoom(double factor)
+{
+    const auto newZoom = std::min(std::max(zoom_ * factor, minZoom), maxZoom);
+
+    // Keep the map pixel at the center of the window where it is.
+    const auto centerX = viewX_ + winWidth_ / 2.0 / zoom_;
+    const auto centerY = viewY_ + winHeight_ / 2.0 / zoom_;
+    zoom_ = newZoom;
+    viewX_ = centerX - winWidth_ / 2.0 / zoom_;
+    viewY_ = centerY - winHeight_ / 2.0 / zoom_;
+    boundViewport();
+    damageAll();
+}
+
+double GameWindow::viewX() const
+{
+    return viewX_;
+}
+
+double GameWindow::viewY() const
+{
+    return viewY_;
+}
+
+double GameWindow::zoomLevel() const
+{
+    return zoom_;
+}
+
+void GameWindow::setView(double x, double y, double zoomLevel)
+{
+    viewX_ = x;
+    viewY_ = y;
+    zoom_ = std::min(std::max(zoomLevel, minZoom), maxZoom);
+    boundViewport();
+    damageAll();
 }
 
 void GameWindow::addEntity(int id, SDL_Point pixel, const SdlSurface &surf)
@@ -39,26 +169,150 @@ void GameWindow::addEntity(int id, SDL_Point pixel, const SdlSurface &surf)
     DrawableEntity e;
     e.id = id;
     e.pixel = pixel;
-    e.img = SdlTexture{surf, win_};
+    e.moveFrom = pixel;
+    e.moveTo = pixel;
+    e.moveStart = 0;
+    e.isMoving = false;
+    e.isVisible = true;
+    e.img = atlas_.add(surf);
+    addDamage(entityBounds(e));
+    entityGrid_.insert(e.id, entityMapBounds(e));
 
-    // TODO: this needs to be sorted
-    entities_.push_back(std::move(e));
+    // Keep entities sorted by id, which is also the order they're drawn in.
+    auto it = upper_bound(begin(entities_), end(entities_), id,
+        [] (int id, const DrawableEntity &elem) { return id < elem.id; });
+    entities_.insert(it, std::move(e));
 }
 
 void GameWindow::moveEntity(int id, SDL_Point pixel)
 {
+    auto entity = findEntity(id);
+    if (!entity) {
+        return;
+    }
+
+    // A move that interrupts another one starts from wherever the entity is
+    // drawn now.
+    if (!entity->isMoving) {
+        ++numMoving_;
+    }
+    entity->moveFrom = entity->pixel;
+    entity->moveTo = pixel;
+    entity->moveStart = clock_();
+    entity->isMoving = true;
+}
+
+void GameWindow::placeEntity(int id, SDL_Point pixel)
+{
+    auto entity = findEntity(id);
+    if (!entity) {
+        return;
+    }
+
+    if (entity->isMoving) {
+        entity->isMoving = false;
+        --numMoving_;
+    }
+    const auto oldBounds = entityMapBounds(*entity);
+    addDamage(entityBounds(*entity));
+    entity->pixel = pixel;
+    entity->moveFrom = pixel;
+    entity->moveTo = pixel;
+    addDamage(entityBounds(*entity));
+    entityGrid_.move(id, oldBounds, entityMapBounds(*entity));
+}
+
+void GameWindow::setEntityVisible(int id, bool isVisible)
+{
+    auto entity = findEntity(id);
+    if (!entity || entity->isVisible == isVisible) {
+        return;
+    }
+
+    entity->isVisible = isVisible;
+    addDamage(entityBounds(*entity));
+}
+
+SDL_Point GameWindow::mapPixelAt(const SDL_Point &screen) const
+{
+    return {static_cast<int>(std::floor(viewX_ + screen.x / zoom_)),
+            static_cast<int>(std::floor(viewY_ + screen.y / zoom_))};
+}
+
+int GameWindow::entityAt(const SDL_Point &screen) const
+{
+    // Entities are drawn in id order, so the highest id is on top.
+    const auto p = mapPixelAt(screen);
+    int topmost = -1;
+    for (auto id : entityGrid_.candidates(p)) {
+        if (id <= topmost) {
+            continue;
+        }
+
+        auto entity = findEntity(id);
+        if (!entity || !entity->isVisible) {
+            continue;
+        }
+        const auto bounds = entityMapBounds(*entity);
+        if (p.x >= bounds.x && p.x < bounds.x + bounds.w &&
+            p.y >= bounds.y && p.y < bounds.y + bounds.h)
+        {
+            topmost = id;
+        }
+    }
+    return topmost;
+}
+
+int GameWindow::hoverEntity() const
+{
+    return hoverEntity_;
+}
+
+void GameWindow::setHoverEntity(int id)
+{
+    if (id == hoverEntity_) {
+        return;
+    }
+
+    auto oldEntity = findEntity(hoverEntity_);
+    if (oldEntity) {
+        addDamage(entityBounds(*oldEntity));
+    }
+    hoverEntity_ = id;
     auto entity = findEntity(id);
     if (entity) {
-        entity->pixel = pixel;
+        addDamage(entityBounds(*entity));
     }
 }
 
+bool GameWindow::isAnimating() const
+{
+    return numMoving_ > 0;
+}
+
 void GameWindow::draw()
 {
-    win_.clear();
-    advMap_.draw(0, 0);
-    for (auto &e : entities_) {
-        e.img.drawCentered(e.pixel);
+    animate();
+    if (damage_.empty()) {
+        return;
+    }
+
+    mapTiles_.beginFrame();
+    if (frame_) {
+        SdlRenderTarget target{win_.getRenderer(), frame_.get()};
+        for (const auto &rect : damage_) {
+            drawScene(rect);
+        }
+    }
+    else {
+        // Nothing survives between frames, so every frame is a full redraw.
+        drawScene({0, 0, winWidth_, winHeight_});
+    }
+    damage_.clear();
+
+    if (frame_) {
+        win_.clear();
+        frame_.draw(0, 0);
     }
     win_.draw();
 }
@@ -79,3 +333,186 @@ DrawableEntity * GameWindow::findEntity(int id)
 {
     return const_cast<DrawableEntity *>(const_cast<const GameWindow &>(*this).findEntity(id));
 }
+
+void GameWindow::boundViewport()
+{
+    const auto viewW = winWidth_ / zoom_;
+    const auto viewH = winHeight_ / zoom_;
+
+    if (viewW >= mapWidth_) {
+        viewX_ = (mapWidth_ - viewW) / 2;
+    }
+    else {
+        viewX_ = std::min(std::max(viewX_, 0.0), mapWidth_ - viewW);
+    }
+    if (viewH >= mapHeight_) {
+        viewY_ = (mapHeight_ - viewH) / 2;
+    }
+    else {
+        viewY_ = std::min(std::max(viewY_, 0.0), mapHeight_ - viewH);
+    }
+}
+
+int GameWindow::screenX(double mapX) const
+{
+    return static_cast<int>(std::floor((mapX - viewX_) * zoom_));
+}
+
+int GameWindow::screenY(double mapY) const
+{
+    return static_cast<int>(std::floor((mapY - viewY_) * zoom_));
+}
+
+int GameWindow::mapLevel() const
+{
+    // Use the most detailed level that is no larger than the screen needs,
+    // so zoomed-out views don't rasterize pixels only to throw them away.
+    int level = 0;
+    while (level + 1 < mapTiles_.numLevels() && zoom_ * (2 << level) <= 1.0) {
+        ++level;
+    }
+    return level;
+}
+
+SDL_Rect GameWindow::entityMapBounds(const DrawableEntity &e) const
+{
+    return {e.pixel.x - e.img.rect.w / 2,
+            e.pixel.y - e.img.rect.h / 2,
+            e.img.rect.w,
+            e.img.rect.h};
+}
+
+SDL_Rect GameWindow::entityBounds(const DrawableEntity &e) const
+{
+    // Match the rounding SdlTextureAtlas::drawCentered uses.
+    const auto w = static_cast<int>(e.img.rect.w * zoom_);
+    const auto h = static_cast<int>(e.img.rect.h * zoom_);
+    return {screenX(e.pixel.x) - w / 2, screenY(e.pixel.y) - h / 2, w, h};
+}
+
+void GameWindow::animate()
+{
+    if (numMoving_ == 0) {
+        return;
+    }
+
+    const auto now = clock_();
+    for (auto &e : entities_) {
+        if (!e.isMoving) {
+            continue;
+        }
+
+        // Ease out so the entity slows down as it arrives.
+        const auto t = std::min((now - e.moveStart) /
+                                static_cast<double>(moveMs), 1.0);
+        const auto s = 1.0 - (1.0 - t) * (1.0 - t);
+        const SDL_Point p = {
+            e.moveFrom.x + static_cast<int>((e.moveTo.x - e.moveFrom.x) * s),
+            e.moveFrom.y + static_cast<int>((e.moveTo.y - e.moveFrom.y) * s)
+        };
+
+        if (p.x != e.pixel.x || p.y != e.pixel.y) {
+            const auto oldBounds = entityMapBounds(e);
+            addDamage(entityBounds(e));
+            e.pixel = p;
+            addDamage(entityBounds(e));
+            entityGrid_.move(e.id, oldBounds, entityMapBounds(e));
+        }
+        if (t >= 1.0) {
+            e.isMoving = false;
+            --numMoving_;
+        }
+    }
+}
+
+void GameWindow::addDamage(const SDL_Rect &rect)
+{
+    const SDL_Rect window = {0, 0, winWidth_, winHeight_};
+    SDL_Rect clipped;
+    if (!SDL_IntersectRect(&rect, &window, &clipped)) {
+        return;  // offscreen
+    }
+
+    if (static_cast<int>(damage_.size()) < maxDamageRects) {
+        damage_.push_back(clipped);
+        return;
+    }
+
+    for (std::size_t i = 1; i < damage_.size(); ++i) {
+        SDL_UnionRect(&damage_[0], &damage_[i], &damage_[0]);
+    }
+    SDL_UnionRect(&damage_[0], &clipped, &damage_[0]);
+    damage_.resize(1);
+}
+
+void GameWindow::damageAll()
+{
+    damage_.assign(1, SDL_Rect{0, 0, winWidth_, winHeight_});
+}
+
+void GameWindow::drawScene(const SDL_Rect &clip)
+{
+    SdlClipRect guard{win_.getRenderer(), clip};
+    win_.fillRect(clip, BLACK);
+    drawMap(clip);
+
+    // Entities entirely outside the damaged area are skipped, which also
+    // culls everything offscreen.
+    for (const auto &e : entities_) {
+        if (!e.isVisible) {
+            continue;
+        }
+
+        const auto bounds = entityBounds(e);
+        if (SDL_HasIntersection(&bounds, &clip)) {
+            const SDL_Point screen = {screenX(e.pixel.x), screenY(e.pixel.y)};
+            atlas_.drawCentered(e.img, screen, zoom_);
+        }
+    }
+    atlas_.flush();
+
+    // The outline sits inside the sprite's bounds, so damage to the entity
+    // covers it too.
+    auto hover = findEntity(hoverEntity_);
+    if (hover && hover->isVisible) {
+        const auto bounds = entityBounds(*hover);
+        if (SDL_HasIntersection(&bounds, &clip)) {
+            win_.drawRect(bounds, YELLOW);
+        }
+    }
+}
+
+void GameWindow::drawMap(const SDL_Rect &clip)
+{
+    if (mapWidth_ <= 0 || mapHeight_ <= 0) {
+        return;
+    }
+
+    const int level = mapLevel();
+    const int scale = 1 << level;
+    const int levelW = mapTiles_.levelWidth(level);
+    const int levelH = mapTiles_.levelHeight(level);
+
+    // Range of tiles touching the clip rectangle.
+    const auto ts = mapTiles_.tileSize();
+    const auto left = (viewX_ + clip.x / zoom_) / scale;
+    const auto top = (viewY_ + clip.y / zoom_) / scale;
+    const auto right = std::min(left + clip.w / zoom_ / scale, levelW - 1.0);
+    const auto bottom = std::min(top + clip.h / zoom_ / scale, levelH - 1.0);
+    const int txMin = std::max(static_cast<int>(left / ts), 0);
+    const int tyMin = std::max(static_cast<int>(top / ts), 0);
+    const int txMax = static_cast<int>(right / ts);
+    const int tyMax = static_cast<int>(bottom / ts);
+
+    for (int ty = tyMin; ty <= tyMax; ++ty) {
+        // Compute both edges of each tile from map coordinates so adjacent
+        // tiles never leave a gap due to rounding.
+        const int y1 = screenY(ty * ts * scale);
+        const int y2 = screenY(std::min((ty + 1) * ts, levelH) * scale);
+        for (int tx = txMin; tx <= txMax; ++tx) {
+            const int x1 = screenX(tx * ts * scale);
+            const int x2 = screenX(std::min((tx + 1) * ts, levelW) * scale);
+            mapTiles_.draw(level, tx, ty, {x1, y1, x2 - x1, y2 - y1});
+        }
+    }
+}
@@ -13,38 +13,142 @@
 #ifndef GAME_WINDOW_H
 #define GAME_WINDOW_H
 
-#include "SdlTextureStream.h"
+#include "SdlTextureAtlas.h"
 #include "SdlWindow.h"
+#include "SpatialGrid.h"
+#include "TileCache.h"
+#include <functional>
 #include <vector>
 
 struct DrawableEntity
 {
     int id;
-    SDL_Point pixel;
-    SdlTexture img;
+    SDL_Point pixel;  // where the entity is drawn right now
+    SDL_Point moveFrom;
+    SDL_Point moveTo;
+    Uint32 moveStart;  // in SDL ticks
+    bool isMoving;
+    bool isVisible;
+    AtlasSprite img;
 };
 
 
 class GameWindow
 {
 public:
+    using Clock = std::function<Uint32 ()>;
+
     GameWindow(int width, int height, const char *title);
 
-    SdlSurface getBlankMap() const;
-    void updateMap(const SdlSurface &surf);
+    // Where animations get the current time, in milliseconds.  SDL ticks by
+    // default.  Replays substitute the times the original session saw.
+    void setClock(Clock clock);
+
+    // Size of the full map, how many levels of detail it has, and the
+    // function that rasterizes any piece of any level.
+    void setMap(int width, int height, int numLevels,
+                TileCache::TileRenderer fn);
+
+    // The map has changed and needs to be rasterized again.
+    void invalidateMap();
+    void invalidateMap(int level, const SDL_Rect &levelRect);
+
+    // Move the viewport by (dx,dy) screen pixels.
+    void scroll(int dx, int dy);
+
+    // Scale the view up (> 1.0) or down (< 1.0) about the center of the
+    // window.
+    void zoom(double factor);
+
+    // Map pixel at the upper-left corner of the window, and the scale it's
+    // drawn at.  Setting them is kept within the same limits as scrolling and
+    // zooming.
+    double viewX() const;
+    double viewY() const;
+    double zoomLevel() const;
+    void setView(double x, double y, double zoomLevel);
 
+    // Entity positions are in map pixels, not screen pixels.  Moves are
+    // animated over a short time rather than jumping to the destination.
     void addEntity(int id, SDL_Point pixel, const SdlSurface &surf);
     void moveEntity(int id, SDL_Point pixel);
 
+    // Put an entity somewhere without animating the move.
+    void placeEntity(int id, SDL_Point pixel);
+
+    // Hidden entities aren't drawn, but keep animating so they're in the
+    // right place if they come back into view.
+    void setEntityVisible(int id, bool isVisible);
+
+    // Map pixel under a point in the window.
+    SDL_Point mapPixelAt(const SDL_Point &screen) const;
+
+    // Return the topmost visible entity under a point in the window, or -1 if
+    // there isn't one.
+    int entityAt(const SDL_Point &screen) const;
+
+    // Entity outlined to show it's under the mouse, -1 for none.
+    int hoverEntity() const;
+    void setHoverEntity(int id);
+
+    // True if any entity is partway through a move, meaning every frame
+    // needs to be drawn until it finishes.
+    bool isAnimating() const;
+
+    // Redraw the parts of the window that changed since the last call, if
+    // any.  The scene is kept in an offscreen texture between frames.
     void draw();
 
+    // Mark the whole window as needing to be redrawn.
+    void damageAll();
+
 private:
     const DrawableEntity * findEntity(int id) const;
     DrawableEntity * findEntity(int id);
 
+    // Keep the viewport over the map, centering the map if it's smaller than
+    // the window.
+    void boundViewport();
+
+    int screenX(double mapX) const;
+    int screenY(double mapY) const;
+
+    // Return the pyramid level used to draw the map at the current zoom.
+    int mapLevel() const;
+
+    // Screen area covered by an entity's sprite.
+    SDL_Rect entityBounds(const DrawableEntity &e) const;
+
+    // Same area in map pixels, which doesn't change with the view.
+    SDL_Rect entityMapBounds(const DrawableEntity &e) const;
+
+    // Advance moving entities to where they should be at the current time.
+    void animate();
+
+    // Mark part of the window as needing to be redrawn.
+    void addDamage(const SDL_Rect &rect);
+
+    // Redraw everything that overlaps the clip rectangle.
+    void drawScene(const SDL_Rect &clip);
+    void drawMap(const SDL_Rect &clip);
+
     SdlWindow win_;
-    SdlTextureStream advMap_;
+    int winWidth_;
+    int winHeight_;
+    SdlTexture frame_;
+    std::vector<SDL_Rect> damage_;
+    TileCache mapTiles_;
+    int mapWidth_;
+    int mapHeight_;
+    double viewX_;  // map pixel at the upper-left corner of the window
+    double viewY_;
+    double zoom_;
+    SdlTextureAtlas atlas_;
     std::vector<DrawableEntity> entities_;
+    SpatialGrid entityGrid_;
+    int numMoving_;
+    int hoverEntity_;
+    Clock clock_;
 };
 
 #endif
@@ -0,0 +1,157 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "Heatmap.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cassert>
+#include <functional>
+
+namespace
+{
+    const int rowsPerBand = 16;
+}
+
+Heatmap::Heatmap(int cols, int rows, int numTeams, int radius,
+                 ThreadPool *pool)
+    : cols_{cols},
+    rows_{rows},
+    numTeams_{numTeams},
+    radius_{radius},
+    pool_{pool},
+    kernel_(2 * radius + 1),
+    sources_(cols * rows * numTeams, 0.0f),
+    temp_(sources_.size(), 0.0f),
+    field_(sources_.size(), 0.0f)
+{
+    assert(cols > 0 && rows > 0 && radius >= 0);
+    for (int k = -radius; k <= radius; ++k) {
+        kernel_[k + radius] = 1.0f - std::abs(k) / (radius + 1.0f);
+    }
+}
+
+int Heatmap::cols() const
+{
+    return cols_;
+}
+
+int Heatmap::rows() const
+{
+    return rows_;
+}
+
+int Heatmap::numTeams() const
+{
+    return numTeams_;
+}
+
+int Heatmap::radius() const
+{
+    return radius_;
+}
+
+void Heatmap::clear()
+{
+    fill(begin(sources_), end(sources_), 0.0f);
+}
+
+void Heatmap::addSource(int team, int col, int row, float amount)
+{
+    if (team < 0 || team >= numTeams_ ||
+        col < 0 || col >= cols_ || row < 0 || row >= rows_)
+    {
+        return;
+    }
+    plane(sources_, team)[row * cols_ + col] += amount;
+}
+
+void Heatmap::blur()
+{
+    const int bandsPerTeam = (rows_ + rowsPerBand - 1) / rowsPerBand;
+    const int numTasks = bandsPerTeam * numTeams_;
+    auto runPass = [&] (void (Heatmap::*pass)(int, int, int)) {
+        auto task = [&] (int i) {
+            const int team = i / bandsPerTeam;
+            const int first = (i % bandsPerTeam) * rowsPerBand;
+            (this->*pass)(team, first, std::min(first + rowsPerBand, rows_));
+        };
+        if (pool_) {
+            // Passed by reference so the std::function doesn't have to
+            // allocate a copy of the lambda.
+            pool_->parallelFor(numTasks, std::ref(task));
+        }
+        else {
+            for (int i = 0; i < numTasks; ++i) {
+                task(i);
+            }
+        }
+    };
+
+    // Every column pass reads rows from neighboring bands, so all the row
+    // passes have to finish first.
+    runPass(&Heatmap::blurRows);
+    runPass(&Heatmap::blurColumns);
+}
+
+float Heatmap::get(int team, int col, int row) const
+{
+    assert(team >= 0 && team < numTeams_);
+    assert(col >= 0 && col < cols_ && row >= 0 && row < rows_);
+    return field_[(team * rows_ + row) * cols_ + col];
+}
+
+float * Heatmap::plane(std::vector<float> &buf, int team)
+{
+    return &buf[team * rows_ * cols_];
+}
+
+void Heatmap::blurRows(int team, int firstRow, int lastRow)
+{
+    const auto src = plane(sources_, team);
+    const auto dest = plane(temp_, team);
+
+    // Loop over kernel taps on the outside so the inner loop is a straight
+    // multiply-add over a row, which the compiler can vectorize.
+    for (int y = firstRow; y < lastRow; ++y) {
+        const auto in = src + y * cols_;
+        const auto out = dest + y * cols_;
+        std::fill(out, out + cols_, 0.0f);
+        for (int k = -radius_; k <= radius_; ++k) {
+            const auto w = kernel_[k + radius_];
+            const int xBegin = std::max(0, -k);
+            const int xEnd = std::min(cols_, cols_ - k);
+            for (int x = xBegin; x < xEnd; ++x) {
+                out[x] += w * in[x + k];
+            }
+        }
+    }
+}
+
+void Heatmap::blurColumns(int team, int firstRow, int lastRow)
+{
+    const auto src = plane(temp_, team);
+    const auto dest = plane(field_, team);
+
+    for (int y = firstRow; y < lastRow; ++y) {
+        const auto out = dest + y * cols_;
+        std::fill(out, out + cols_, 0.0f);
+        const int kBegin = std::max(-radius_, -y);
+        const int kEnd = std::min(radius_, rows_ - 1 - y);
+        for (int k = kBegin; k <= kEnd; ++k) {
+            const auto w = kernel_[k + radius_];
+            const auto in = src + (y + k) * cols_;
+            for (int x = 0; x < cols_; ++x) {
+                out[x] += w * in[x];
+            }
+        }
+    }
+}
@@ -0,0 +1,65 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+#include <vector>
+
+class ThreadPool;
+
+// Smooth per-team influence over a grid of cells.  Each source's strength
+// falls off linearly with distance out to a fixed radius (a pyramid, since
+// the kernel is applied along rows and then columns).  The grid is meant to
+// be much coarser than the screen and interpolated when drawn.
+class Heatmap
+{
+public:
+    // Without a thread pool, blurring runs on the calling thread.
+    Heatmap(int cols, int rows, int numTeams, int radius,
+            ThreadPool *pool = nullptr);
+
+    int cols() const;
+    int rows() const;
+    int numTeams() const;
+    int radius() const;
+
+    // Remove all sources.
+    void clear();
+    void addSource(int team, int col, int row, float amount);
+
+    // Spread every source over its neighborhood.  Call after adding sources
+    // and before reading values.
+    void blur();
+
+    float get(int team, int col, int row) const;
+
+private:
+    float * plane(std::vector<float> &buf, int team);
+
+    // Each pass writes rows [firstRow, lastRow) of one team's plane, so any
+    // number of bands can run at once.
+    void blurRows(int team, int firstRow, int lastRow);
+    void blurColumns(int team, int firstRow, int lastRow);
+
+    int cols_;
+    int rows_;
+    int numTeams_;
+    int radius_;
+    ThreadPool *pool_;
+    std::vector<float> kernel_;
+    std::vector<float> sources_;  // one cols x rows plane per team
+    std::vector<float> temp_;
+    std::vector<float> field_;
+};
+
+#endif
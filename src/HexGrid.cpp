@@ -0,0 +1,127 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "HexGrid.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+HexGrid::HexGrid()
+    : cols_{0},
+    rows_{0},
+    hexWidth_{0},
+    hexHeight_{0},
+    colStep_{0},
+    blockMask_{}
+{
+}
+
+HexGrid::HexGrid(int cols, int rows, int hexWidth)
+    : cols_{cols},
+    rows_{rows},
+    hexWidth_{hexWidth / 4 * 4},
+    hexHeight_{static_cast<int>(std::lround(hexWidth_ * std::sqrt(3.0) / 2))},
+    colStep_{hexWidth_ * 3 / 4},
+    blockMask_{}
+{
+    assert(cols > 0 && rows > 0 && hexWidth_ >= 4);
+
+    // One block spans two columns and one row, starting at the left edge of
+    // an even column.  Each pixel belongs to whichever nearby hex center is
+    // closest, which is exactly the hexagon containing it.
+    const int blockW = 2 * colStep_;
+    const int blockH = hexHeight_;
+    blockMask_.resize(blockW * blockH);
+    for (int y = 0; y < blockH; ++y) {
+        for (int x = 0; x < blockW; ++x) {
+            const double px = x + 0.5;
+            const double py = y + 0.5;
+            double bestDist = -1.0;
+            SDL_Point best = {0, 0};
+            for (int dc = -1; dc <= 2; ++dc) {
+                for (int dr = -1; dr <= 1; ++dr) {
+                    const double cx = dc * colStep_ + hexWidth_ / 2.0;
+                    const double cy = dr * hexHeight_ + hexHeight_ / 2.0 +
+                        ((dc + 2) % 2) * hexHeight_ / 2.0;
+                    const auto dist = (px - cx) * (px - cx) +
+                        (py - cy) * (py - cy);
+                    if (bestDist < 0 || dist < bestDist) {
+                        bestDist = dist;
+                        best = {dc, dr};
+                    }
+                }
+            }
+            blockMask_[y * blockW + x] = best;
+        }
+    }
+}
+
+HexGrid HexGrid::fit(int mapWidth, int mapHeight, int hexWidth)
+{
+    const int w = hexWidth / 4 * 4;
+    const int h = static_cast<int>(std::lround(w * std::sqrt(3.0) / 2));
+    const int cols = std::max((mapWidth - w / 4) / (w * 3 / 4), 1);
+    const int rows = std::max((mapHeight - h / 2) / h, 1);
+    return HexGrid(cols, rows, hexWidth);
+}
+
+int HexGrid::cols() const
+{
+    return cols_;
+}
+
+int HexGrid::rows() const
+{
+    return rows_;
+}
+
+int HexGrid::size() const
+{
+    return cols_ * rows_;
+}
+
+int HexGrid::hexWidth() const
+{
+    return hexWidth_;
+}
+
+int HexGrid::hexHeight() const
+{
+    return hexHeight_;
+}
+
+int HexGrid::hexFromPixel(const SDL_Point &p) const
+{
+    if (p.x < 0 || p.y < 0 || size() == 0) {
+        return -1;
+    }
+
+    const int blockW = 2 * colStep_;
+    const int blockH = hexHeight_;
+    const auto &offset = blockMask_[(p.y % blockH) * blockW + p.x % blockW];
+    const int c = std::min(std::max(p.x / blockW * 2 + offset.x, 0),
+                           cols_ - 1);
+    const int r = std::min(std::max(p.y / blockH + offset.y, 0), rows_ - 1);
+    return r * cols_ + c;
+}
+
+SDL_Point HexGrid::centerPixel(int hex) const
+{
+    if (hex < 0 || hex >= size()) {
+        return {-1, -1};
+    }
+
+    const int c = hex % cols_;
+    const int r = hex / cols_;
+    return {c * colStep_ + hexWidth_ / 2,
+            r * hexHeight_ + hexHeight_ / 2 + (c % 2) * hexHeight_ / 2};
+}
@@ -0,0 +1,59 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef HEX_GRID_H
+#define HEX_GRID_H
+
+#include "sdl_utils.h"
+#include <vector>
+
+// Pixel layout of the hexes in makeHexGraph().  Hexes are flat-topped, odd
+// columns are shifted down by half a hex, and hex 0 touches the upper-left
+// corner of the map.
+//
+// The layout repeats every two columns and every row, so we precompute which
+// hex owns each pixel of one repeating block.  Finding the hex under any
+// pixel is then two divisions and a table lookup, with no floating point.
+class HexGrid
+{
+public:
+    HexGrid();
+
+    // 'hexWidth' is measured from corner to corner and is rounded down to a
+    // multiple of 4 so columns line up on whole pixels.
+    HexGrid(int cols, int rows, int hexWidth);
+
+    // Use as many hexes of the given width as fit in a map of the given
+    // size.
+    static HexGrid fit(int mapWidth, int mapHeight, int hexWidth);
+
+    int cols() const;
+    int rows() const;
+    int size() const;
+    int hexWidth() const;
+    int hexHeight() const;
+
+    // Hex under a pixel.  Pixels beyond the last row or column, including the
+    // ragged edges, belong to the nearest hex on that side.
+    int hexFromPixel(const SDL_Point &p) const;
+    SDL_Point centerPixel(int hex) const;
+
+private:
+    int cols_;
+    int rows_;
+    int hexWidth_;
+    int hexHeight_;
+    int colStep_;  // horizontal distance between neighboring columns
+    std::vector<SDL_Point> blockMask_;  // (column, row) offset per pixel
+};
+
+#endif
@@ -0,0 +1,319 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "InfluenceMap.h"
+#include <algorithm>
+#include <cassert>
+
+InfluenceMap::InfluenceMap(RegionGraph graph, int numTeams)
+    : graph_(std::make_shared<RegionGraph>(std::move(graph))),
+    numTeams_{numTeams},
+    state_(std::make_shared<InfluenceState>()),
+    changedRegions_{},
+    ownerChanges_{},
+    edgeOffsets_{},
+    edgeIds_{},
+    edges_{},
+    frontierPos_{},
+    frontier_{},
+    frontierIds_{}
+{
+    state_->influence.assign(graph_->size() * numTeams_, 0);
+    state_->owners.assign(graph_->size(), -1);
+    changedRegions_.reserve(graph_->size());
+    ownerChanges_.reserve(graph_->size());
+    buildEdges();
+}
+
+int InfluenceMap::numRegions() const
+{
+    return graph_->size();
+}
+
+int InfluenceMap::numTeams() const
+{
+    return numTeams_;
+}
+
+const RegionGraph & InfluenceMap::graph() const
+{
+    return *graph_;
+}
+
+void InfluenceMap::addEntity(MapEntity entity)
+{
+    auto &entities = mutableState().entities;
+    auto it = upper_bound(begin(entities), end(entities), entity.id,
+        [] (int id, const MapEntity &elem) { return id < elem.id; });
+    entities.insert(it, entity);
+}
+
+void InfluenceMap::moveEntity(int id, int toReg)
+{
+    if (!findEntity(id)) {
+        return;
+    }
+
+    // Look the entity up again in case the state was copied.
+    auto &entities = mutableState().entities;
+    auto it = lower_bound(begin(entities), end(entities), id,
+        [] (const MapEntity &elem, int id) { return elem.id < id; });
+    it->region = toReg;
+}
+
+int InfluenceMap::getRegion(int entityId) const
+{
+    auto entity = findEntity(entityId);
+    if (!entity) {
+        return -1;
+    }
+    return entity->region;
+}
+
+const std::vector<MapEntity> & InfluenceMap::entities() const
+{
+    return state_->entities;
+}
+
+void InfluenceMap::update()
+{
+    relaxInfluence();
+
+    auto &owners = state_->owners;
+    changedRegions_.clear();
+    ownerChanges_.clear();
+    for (int r = 0; r < numRegions(); ++r) {
+        const auto owner = computeOwner(r);
+        if (owner != owners[r]) {
+            ownerChanges_.push_back(OwnerChange{r, owners[r], owner});
+            owners[r] = owner;
+            changedRegions_.push_back(r);
+        }
+    }
+
+    for (auto r : changedRegions_) {
+        updateFrontier(r);
+    }
+}
+
+int InfluenceMap::getOwner(int region) const
+{
+    assert(region >= 0 && region < numRegions());
+    return state_->owners[region];
+}
+
+int InfluenceMap::getInfluence(int region, int team) const
+{
+    assert(team >= 0 && team < numTeams_);
+    return state_->influence[region * numTeams_ + team];
+}
+
+const std::vector<int> & InfluenceMap::changedRegions() const
+{
+    return changedRegions_;
+}
+
+const std::vector<OwnerChange> & InfluenceMap::ownerChanges() const
+{
+    return ownerChanges_;
+}
+
+const std::vector<FrontierEdge> & InfluenceMap::frontier() const
+{
+    return frontier_;
+}
+
+bool InfluenceMap::isFrontier(int reg1, int reg2) const
+{
+    const auto nbrs = graph_->neighbors(reg1);
+    const auto it = std::find(nbrs.begin(), nbrs.end(), reg2);
+    if (it == nbrs.end()) {
+        return false;
+    }
+    return frontierPos_[edgeId(reg1, it - nbrs.begin())] >= 0;
+}
+
+InfluenceSnapshot InfluenceMap::snapshot() const
+{
+    return InfluenceSnapshot(graph_, numTeams_, state_);
+}
+
+std::shared_ptr<const InfluenceState> InfluenceMap::sharedState() const
+{
+    return state_;
+}
+
+bool InfluenceMap::restore(InfluenceState state)
+{
+    const auto n = numRegions();
+    if (static_cast<int>(state.owners.size()) != n ||
+        static_cast<int>(state.influence.size()) != n * numTeams_)
+    {
+        return false;
+    }
+    for (const auto &e : state.entities) {
+        if (e.region < 0 || e.region >= n) {
+            return false;
+        }
+    }
+    if (!is_sorted(begin(state.entities), end(state.entities),
+                   [] (const MapEntity &lhs, const MapEntity &rhs) {
+                       return lhs.id < rhs.id;
+                   }))
+    {
+        return false;
+    }
+
+    ownerChanges_.clear();
+    for (int r = 0; r < n; ++r) {
+        if (state.owners[r] != state_->owners[r]) {
+            ownerChanges_.push_back(
+                OwnerChange{r, state_->owners[r], state.owners[r]});
+        }
+    }
+
+    state_ = std::make_shared<InfluenceState>(std::move(state));
+    changedRegions_.clear();
+    for (int r = 0; r < n; ++r) {
+        changedRegions_.push_back(r);
+    }
+    for (const auto &change : ownerChanges_) {
+        updateFrontier(change.region);
+    }
+    return true;
+}
+
+int InfluenceMap::computeOwner(int region) const
+{
+    return ownerFromInfluence(&state_->influence[region * numTeams_],
+                              numTeams_);
+}
+
+void InfluenceMap::buildEdges()
+{
+    const auto n = numRegions();
+    edgeOffsets_.assign(n + 1, 0);
+    for (int r = 0; r < n; ++r) {
+        edgeOffsets_[r + 1] = edgeOffsets_[r] + graph_->numNeighbors(r);
+    }
+
+    // The lower-numbered end of each edge names it.  The higher end finds
+    // the same edge in its neighbor's list.  A neighbor that doesn't list us
+    // back gets an edge of its own.
+    edgeIds_.assign(edgeOffsets_[n], -1);
+    edges_.clear();
+    for (int r = 0; r < n; ++r) {
+        const auto nbrs = graph_->neighbors(r);
+        for (auto it = nbrs.begin(); it != nbrs.end(); ++it) {
+            const auto other = *it;
+            auto id = -1;
+            if (other < r) {
+                const auto back = graph_->neighbors(other);
+                const auto found = std::find(back.begin(), back.end(), r);
+                if (found != back.end()) {
+                    id = edgeId(other, found - back.begin());
+                }
+            }
+            if (id < 0) {
+                id = edges_.size();
+                edges_.push_back(FrontierEdge{std::min(r, other),
+                                              std::max(r, other)});
+            }
+            edgeIds_[edgeOffsets_[r] + (it - nbrs.begin())] = id;
+        }
+    }
+
+    frontierPos_.assign(edges_.size(), -1);
+    frontier_.clear();
+    frontier_.reserve(edges_.size());
+    frontierIds_.clear();
+    frontierIds_.reserve(edges_.size());
+}
+
+int InfluenceMap::edgeId(int region, int nth) const
+{
+    return edgeIds_[edgeOffsets_[region] + nth];
+}
+
+void InfluenceMap::updateFrontier(int region)
+{
+    const auto &owners = state_->owners;
+    const auto nbrs = graph_->neighbors(region);
+    for (auto it = nbrs.begin(); it != nbrs.end(); ++it) {
+        setFrontier(edgeId(region, it - nbrs.begin()),
+                    owners[region] != owners[*it]);
+    }
+}
+
+void InfluenceMap::setFrontier(int edge, bool isFrontier)
+{
+    const auto pos = frontierPos_[edge];
+    if (isFrontier == (pos >= 0)) {
+        return;
+    }
+
+    if (isFrontier) {
+        frontierPos_[edge] = frontier_.size();
+        frontier_.push_back(edges_[edge]);
+        frontierIds_.push_back(edge);
+        return;
+    }
+
+    // Fill the hole with the last entry so removing doesn't shift the rest.
+    const auto last = frontierIds_.back();
+    frontier_[pos] = frontier_.back();
+    frontierIds_[pos] = last;
+    frontierPos_[last] = pos;
+    frontier_.pop_back();
+    frontierIds_.pop_back();
+    frontierPos_[edge] = -1;
+}
+
+void InfluenceMap::relaxInfluence()
+{
+    auto &state = mutableState();
+    auto &influence = state.influence;
+    fill(begin(influence), end(influence), 0);
+
+    for (const auto &e : state.entities) {
+        const auto team = e.team;
+        if (team < 0 || team >= numTeams_) {
+            continue;  // unowned, exerts no influence
+        }
+
+        spreadInfluence(*graph_, e.region, e.influence,
+            [&] (int r, int amount) {
+                influence[r * numTeams_ + team] += amount;
+            });
+    }
+}
+
+InfluenceState & InfluenceMap::mutableState()
+{
+    if (!state_.unique()) {
+        state_ = std::make_shared<InfluenceState>(*state_);
+    }
+    return *state_;
+}
+
+const MapEntity * InfluenceMap::findEntity(int id) const
+{
+    const auto &entities = state_->entities;
+    auto it = lower_bound(begin(entities), end(entities), id,
+        [] (const MapEntity &elem, int id) { return elem.id < id; });
+
+    if (it != end(entities) && it->id == id) {
+        return &*it;
+    }
+
+    return nullptr;
+}
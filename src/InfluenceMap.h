@@ -0,0 +1,132 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef INFLUENCE_MAP_H
+#define INFLUENCE_MAP_H
+
+#include "InfluenceSnapshot.h"
+#include "InfluenceState.h"
+#include "RegionGraph.h"
+#include <memory>
+#include <vector>
+
+// A region changing hands during an update.  Owners are team numbers, or -1
+// for a region where no team leads.
+struct OwnerChange
+{
+    int region;
+    int oldOwner;
+    int newOwner;
+};
+
+// Two neighboring regions with different owners, with a < b.
+struct FrontierEdge
+{
+    int a;
+    int b;
+};
+
+
+// Each team's influence over the regions of a map, and who owns each region
+// as a result.  Knows nothing about how the map is drawn.
+//
+// The map's state is shared with any snapshots taken of it.  Changing the map
+// while a snapshot is outstanding makes a private copy first, so snapshots
+// never see later changes.
+class InfluenceMap
+{
+public:
+    InfluenceMap(RegionGraph graph, int numTeams);
+
+    int numRegions() const;
+    int numTeams() const;
+    const RegionGraph & graph() const;
+
+    void addEntity(MapEntity entity);
+    void moveEntity(int id, int toReg);
+    int getRegion(int entityId) const;
+    const std::vector<MapEntity> & entities() const;
+
+    // Return null if there's no entity with that id.
+    const MapEntity * findEntity(int id) const;
+
+    // Recompute each team's influence and the owner of each region after
+    // entities have moved.
+    void update();
+
+    // Return the team number with the most influence in a region as of the
+    // last update, or -1 if all teams have the same influence.
+    int getOwner(int region) const;
+    int getInfluence(int region, int team) const;
+
+    // Regions whose owner changed during the last update.
+    const std::vector<int> & changedRegions() const;
+
+    // Who each of those regions belonged to before and after, in region
+    // order.  After a restore, only regions whose owner really changed are
+    // listed.
+    const std::vector<OwnerChange> & ownerChanges() const;
+
+    // Every pair of neighboring regions with different owners, counting -1
+    // as an owner of its own.  Kept up to date by looking only at the edges
+    // around changed regions, so it costs nothing when little changes.  The
+    // order is arbitrary and shifts as edges come and go.
+    const std::vector<FrontierEdge> & frontier() const;
+    bool isFrontier(int reg1, int reg2) const;
+
+    // Capture the current state without copying it.  Influence is only
+    // recomputed by update(), so take snapshots after calling it.
+    InfluenceSnapshot snapshot() const;
+
+    // Same, for code that only needs the raw state, such as saving it.
+    std::shared_ptr<const InfluenceState> sharedState() const;
+
+    // Replace the whole state, such as from a save file.  Every region is
+    // reported as changed.  Returns false and leaves the map alone if the
+    // state doesn't fit this map.
+    bool restore(InfluenceState state);
+
+private:
+    int computeOwner(int region) const;
+
+    // Number every pair of neighbors once, so each can be found from either
+    // end.
+    void buildEdges();
+
+    // Edge between a region and its nth neighbor.
+    int edgeId(int region, int nth) const;
+
+    // Add or remove edges around a region depending on its neighbors'
+    // owners.
+    void updateFrontier(int region);
+    void setFrontier(int edge, bool isFrontier);
+
+    // Spread each entity's influence to neighboring regions.
+    void relaxInfluence();
+
+    // Make sure no snapshot shares the state before we modify it.
+    InfluenceState & mutableState();
+
+    std::shared_ptr<const RegionGraph> graph_;
+    int numTeams_;
+    std::shared_ptr<InfluenceState> state_;
+    std::vector<int> changedRegions_;
+    std::vector<OwnerChange> ownerChanges_;
+    std::vector<int> edgeOffsets_;  // region i's edges start at edgeOffsets_[i]
+    std::vector<int> edgeIds_;  // parallel to each region's neighbor list
+    std::vector<FrontierEdge> edges_;
+    std::vector<int> frontierPos_;  // per edge, -1 if not on the frontier
+    std::vector<FrontierEdge> frontier_;
+    std::vector<int> frontierIds_;  // edge id of each frontier entry
+};
+
+#endif
@@ -0,0 +1,184 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "InfluenceSnapshot.h"
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+    bool lessIndex(const std::pair<int, int> &lhs, int rhs)
+    {
+        return lhs.first < rhs;
+    }
+}
+
+InfluenceSnapshot::InfluenceSnapshot(std::shared_ptr<const RegionGraph> graph,
+                                     int numTeams,
+                                     std::shared_ptr<const InfluenceState> base)
+    : graph_(std::move(graph)),
+    numTeams_{numTeams},
+    base_(std::move(base)),
+    delta_(std::make_shared<Delta>())
+{
+}
+
+int InfluenceSnapshot::numRegions() const
+{
+    return graph_->size();
+}
+
+int InfluenceSnapshot::numTeams() const
+{
+    return numTeams_;
+}
+
+const RegionGraph & InfluenceSnapshot::graph() const
+{
+    return *graph_;
+}
+
+InfluenceSnapshot InfluenceSnapshot::withMove(int entityId, int toReg) const
+{
+    assert(toReg >= 0 && toReg < numRegions());
+    auto entity = findBaseEntity(entityId);
+    if (!entity) {
+        return *this;
+    }
+
+    const auto fromReg = getRegion(entityId);
+    auto delta = std::make_shared<Delta>(*delta_);
+    const auto team = entity->team;
+    if (fromReg != toReg && team >= 0 && team < numTeams_) {
+        spreadInfluence(*graph_, fromReg, entity->influence,
+            [&] (int r, int amount) {
+                addChange(*delta, r * numTeams_ + team, -amount);
+            });
+        spreadInfluence(*graph_, toReg, entity->influence,
+            [&] (int r, int amount) {
+                addChange(*delta, r * numTeams_ + team, amount);
+            });
+    }
+
+    auto iter = lower_bound(begin(delta->moves), end(delta->moves), entityId,
+                            lessIndex);
+    if (iter != end(delta->moves) && iter->first == entityId) {
+        iter->second = toReg;
+    }
+    else {
+        delta->moves.insert(iter, std::make_pair(entityId, toReg));
+    }
+
+    InfluenceSnapshot ret{*this};
+    ret.delta_ = delta;
+    return ret;
+}
+
+int InfluenceSnapshot::getRegion(int entityId) const
+{
+    const auto &moves = delta_->moves;
+    auto iter = lower_bound(begin(moves), end(moves), entityId, lessIndex);
+    if (iter != end(moves) && iter->first == entityId) {
+        return iter->second;
+    }
+
+    auto entity = findBaseEntity(entityId);
+    if (!entity) {
+        return -1;
+    }
+    return entity->region;
+}
+
+int InfluenceSnapshot::getInfluence(int region, int team) const
+{
+    assert(team >= 0 && team < numTeams_);
+    const auto index = region * numTeams_ + team;
+    auto value = base_->influence[index];
+
+    const auto &changes = delta_->influence;
+    auto iter = lower_bound(begin(changes), end(changes), index, lessIndex);
+    if (iter != end(changes) && iter->first == index) {
+        value += iter->second;
+    }
+    return value;
+}
+
+int InfluenceSnapshot::getOwner(int region) const
+{
+    assert(region >= 0 && region < numRegions());
+    if (!isTouched(region)) {
+        return base_->owners[region];
+    }
+
+    // Start from the base row and apply this region's changes, which are
+    // next to each other in the sorted list.
+    const auto first = region * numTeams_;
+    std::vector<int> teamInfluence(&base_->influence[first],
+                                   &base_->influence[first] + numTeams_);
+    const auto &changes = delta_->influence;
+    auto iter = lower_bound(begin(changes), end(changes), first, lessIndex);
+    for (; iter != end(changes) && iter->first < first + numTeams_; ++iter) {
+        teamInfluence[iter->first - first] += iter->second;
+    }
+    return ownerFromInfluence(teamInfluence.data(), numTeams_);
+}
+
+std::vector<int> InfluenceSnapshot::changedRegions() const
+{
+    // Changes are sorted by index, so each touched region comes up in order.
+    std::vector<int> regions;
+    int lastRegion = -1;
+    for (const auto &change : delta_->influence) {
+        const auto region = change.first / numTeams_;
+        if (region == lastRegion) {
+            continue;
+        }
+        lastRegion = region;
+        if (getOwner(region) != base_->owners[region]) {
+            regions.push_back(region);
+        }
+    }
+    return regions;
+}
+
+const MapEntity * InfluenceSnapshot::findBaseEntity(int id) const
+{
+    const auto &entities = base_->entities;
+    auto it = lower_bound(begin(entities), end(entities), id,
+        [] (const MapEntity &elem, int id) { return elem.id < id; });
+
+    if (it != end(entities) && it->id == id) {
+        return &*it;
+    }
+
+    return nullptr;
+}
+
+void InfluenceSnapshot::addChange(Delta &delta, int index, int change)
+{
+    auto &changes = delta.influence;
+    auto iter = lower_bound(begin(changes), end(changes), index, lessIndex);
+    if (iter != end(changes) && iter->first == index) {
+        iter->second += change;
+    }
+    else {
+        changes.insert(iter, std::make_pair(index, change));
+    }
+}
+
+bool InfluenceSnapshot::isTouched(int region) const
+{
+    const auto &changes = delta_->influence;
+    auto iter = lower_bound(begin(changes), end(changes),
+                            region * numTeams_, lessIndex);
+    return iter != end(changes) && iter->first < (region + 1) * numTeams_;
+}
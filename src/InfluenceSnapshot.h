@@ -0,0 +1,68 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef INFLUENCE_SNAPSHOT_H
+#define INFLUENCE_SNAPSHOT_H
+
+#include "InfluenceState.h"
+#include "RegionGraph.h"
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Immutable view of an InfluenceMap at one point in time, plus any
+// hypothetical moves applied on top.  Taking a snapshot and applying a move
+// never copies the map itself, only a short list of differences, so an AI
+// can try out many moves at once on different threads without disturbing
+// the live map.
+class InfluenceSnapshot
+{
+public:
+    InfluenceSnapshot(std::shared_ptr<const RegionGraph> graph, int numTeams,
+                      std::shared_ptr<const InfluenceState> base);
+
+    int numRegions() const;
+    int numTeams() const;
+    const RegionGraph & graph() const;
+
+    // Return a new snapshot with one entity moved.  Leaves this one alone.
+    InfluenceSnapshot withMove(int entityId, int toReg) const;
+
+    int getRegion(int entityId) const;
+    int getInfluence(int region, int team) const;
+    int getOwner(int region) const;
+
+    // Regions whose owner differs from the state the snapshot was taken from.
+    std::vector<int> changedRegions() const;
+
+private:
+    struct Delta
+    {
+        std::vector<std::pair<int, int>> influence;  // (index, change)
+        std::vector<std::pair<int, int>> moves;      // (entity id, region)
+    };
+
+    const MapEntity * findBaseEntity(int id) const;
+
+    // Add 'change' to an influence entry, keeping the list sorted by index.
+    static void addChange(Delta &delta, int index, int change);
+
+    // True if the deltas touch any of a region's influence entries.
+    bool isTouched(int region) const;
+
+    std::shared_ptr<const RegionGraph> graph_;
+    int numTeams_;
+    std::shared_ptr<const InfluenceState> base_;
+    std::shared_ptr<const Delta> delta_;
+};
+
+#endif
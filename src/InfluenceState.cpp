@@ -0,0 +1,38 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "InfluenceState.h"
+#include <algorithm>
+
+int ownerFromInfluence(const int *teamInfluence, int numTeams)
+{
+    // Separate passes with no early exits, so the compiler can vectorize the
+    // first two when there are many teams.
+    auto maxInfl = 0;
+    for (int team = 0; team < numTeams; ++team) {
+        maxInfl = std::max(maxInfl, teamInfluence[team]);
+    }
+    if (maxInfl == 0) {
+        return -1;
+    }
+
+    auto numLeaders = 0;
+    for (int team = 0; team < numTeams; ++team) {
+        numLeaders += (teamInfluence[team] == maxInfl);
+    }
+    if (numLeaders > 1) {
+        return -1;
+    }
+
+    return std::find(teamInfluence, teamInfluence + numTeams, maxInfl) -
+        teamInfluence;
+}
@@ -0,0 +1,55 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef INFLUENCE_STATE_H
+#define INFLUENCE_STATE_H
+
+#include "RegionGraph.h"
+#include "team.h"
+#include <vector>
+
+struct MapEntity
+{
+    int id;
+    int region;
+    int influence;
+    int team;  // or noTeam
+};
+
+
+// Everything that changes as entities move.  Shared between an InfluenceMap
+// and any snapshots taken of it, and copied only when the map changes while
+// a snapshot still refers to it.
+struct InfluenceState
+{
+    std::vector<int> influence;  // numTeams entries per region
+    std::vector<int> owners;
+    std::vector<MapEntity> entities;  // sorted by id
+};
+
+
+// Return the team with the most influence, or -1 if there's a tie for the
+// lead (including when nobody has any influence).
+int ownerFromInfluence(const int *teamInfluence, int numTeams);
+
+// Call fn(region, amount) for each region an entity spreads its influence to.
+template <typename Func>
+void spreadInfluence(const RegionGraph &graph, int region, int influence,
+                     Func fn)
+{
+    fn(region, influence);
+    for (auto r : graph.neighbors(region)) {
+        fn(r, influence / 4);
+    }
+}
+
+#endif
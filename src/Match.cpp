@@ -0,0 +1,90 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "Match.h"
+
+Match::Match(const MatchConfig &config, unsigned int seed)
+    : config_(config),
+    seed_{seed},
+    randgen_{seed},
+    map_{makeGridGraph(config.cols, config.rows), config.numTeams},
+    planner_{1},
+    turn_{0},
+    regionsOwned_(config.numTeams, 0)
+{
+    std::uniform_int_distribution<int> randRegion(0, map_.numRegions() - 1);
+    int id = 0;
+    for (int t = 0; t < config_.numTeams; ++t) {
+        for (int i = 0; i < config_.entitiesPerTeam; ++i) {
+            map_.addEntity(MapEntity{id++,
+                                     randRegion(randgen_),
+                                     config_.influence,
+                                     t});
+        }
+    }
+    map_.update();
+    countOwnerChanges();
+}
+
+bool Match::isDone() const
+{
+    return turn_ >= config_.turns;
+}
+
+void Match::step()
+{
+    // Plan every AI move against the same state before anything moves.
+    std::vector<PlannedMove> planned;
+    for (int t = 0; t < config_.aiTeams && t < config_.numTeams; ++t) {
+        const auto moves = planner_.plan(map_, t, randgen_());
+        planned.insert(end(planned), begin(moves), end(moves));
+    }
+
+    for (const auto &e : map_.entities()) {
+        if (e.team < config_.aiTeams) {
+            continue;
+        }
+
+        const auto nbrs = map_.graph().neighbors(e.region);
+        const int numNbrs = nbrs.end() - nbrs.begin();
+        if (numNbrs == 0) {
+            continue;
+        }
+
+        std::uniform_int_distribution<int> pick(0, numNbrs - 1);
+        map_.moveEntity(e.id, nbrs.begin()[pick(randgen_)]);
+    }
+    for (const auto &move : planned) {
+        map_.moveEntity(move.entityId, move.toReg);
+    }
+
+    map_.update();
+    countOwnerChanges();
+    ++turn_;
+}
+
+MatchResult Match::result() const
+{
+    return {seed_, turn_, regionsOwned_};
+}
+
+void Match::countOwnerChanges()
+{
+    for (const auto &change : map_.ownerChanges()) {
+        if (change.oldOwner >= 0) {
+            --regionsOwned_[change.oldOwner];
+        }
+        if (change.newOwner >= 0) {
+            ++regionsOwned_[change.newOwner];
+        }
+    }
+}
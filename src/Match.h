@@ -0,0 +1,66 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef MATCH_H
+#define MATCH_H
+
+#include "InfluenceMap.h"
+#include "MovePlanner.h"
+#include <random>
+#include <vector>
+
+struct MatchConfig
+{
+    int cols;
+    int rows;
+    int numTeams;
+    int entitiesPerTeam;
+    int influence;
+    int turns;
+    int aiTeams;  // teams numbered below this use the move planner
+};
+
+struct MatchResult
+{
+    unsigned int seed;
+    int updates;
+    std::vector<int> regionsOwned;  // per team, at the end of the match
+};
+
+
+// One headless game on a grid map.  Every turn each entity either wanders to
+// a random neighboring region or, for AI teams, moves where the planner
+// says.  A match owns all of its state, so any number
+// of them can run on different threads at once.
+class Match
+{
+public:
+    Match(const MatchConfig &config, unsigned int seed);
+
+    bool isDone() const;
+    void step();
+    MatchResult result() const;
+
+private:
+    // Keep the count of regions each team owns in step with the map.
+    void countOwnerChanges();
+
+    MatchConfig config_;
+    unsigned int seed_;
+    std::minstd_rand randgen_;
+    InfluenceMap map_;
+    MovePlanner planner_;
+    int turn_;
+    std::vector<int> regionsOwned_;
+};
+
+#endif
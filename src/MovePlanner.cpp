@@ -0,0 +1,128 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "MovePlanner.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <random>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Fill 'regions' with every region within 'range' steps of 'start',
+    // including 'start' itself, in breadth-first order.
+    void reachable(const RegionGraph &graph, int start, int range,
+                   std::vector<int> &regions, std::vector<int> &dist)
+    {
+        regions.clear();
+        dist.assign(graph.size(), -1);
+        dist[start] = 0;
+        regions.push_back(start);
+
+        for (size_t i = 0; i < regions.size(); ++i) {
+            const auto reg = regions[i];
+            if (dist[reg] == range) {
+                continue;
+            }
+            for (auto nbr : graph.neighbors(reg)) {
+                if (dist[nbr] < 0) {
+                    dist[nbr] = dist[reg] + 1;
+                    regions.push_back(nbr);
+                }
+            }
+        }
+    }
+
+    int scoreMove(const InfluenceSnapshot &base,
+                  const InfluenceSnapshot &after,
+                  int team)
+    {
+        int score = 0;
+        for (auto r : after.changedRegions()) {
+            if (after.getOwner(r) == team) {
+                ++score;
+            }
+            if (base.getOwner(r) == team) {
+                --score;
+            }
+        }
+        return score;
+    }
+}
+
+MovePlanner::MovePlanner(int moveRange, ThreadPool *pool)
+    : moveRange_{moveRange},
+    pool_{pool}
+{
+}
+
+std::vector<PlannedMove> MovePlanner::plan(const InfluenceMap &map, int team,
+                                           unsigned int seed,
+                                           int budgetMs) const
+{
+    const auto snap = map.snapshot();
+    std::vector<PlannedMove> moves;
+    for (const auto &e : map.entities()) {
+        if (e.team == team) {
+            moves.push_back(PlannedMove{e.id, e.region, 0});
+        }
+    }
+
+    const auto deadline = Clock::now() + std::chrono::milliseconds(budgetMs);
+
+    // Each call writes only to its own move, and seeds its own random
+    // generator from the entity id so thread scheduling can't change the
+    // result.
+    auto evaluate = [&] (int i) {
+        auto &move = moves[i];
+        if (budgetMs > 0 && Clock::now() >= deadline) {
+            return;
+        }
+
+        std::vector<int> candidates;
+        std::vector<int> dist;
+        reachable(snap.graph(), move.toReg, moveRange_, candidates, dist);
+
+        std::minstd_rand randgen(seed ^ (move.entityId * 2654435761u));
+        int numTied = 0;
+        for (auto reg : candidates) {
+            const auto score =
+                scoreMove(snap, snap.withMove(move.entityId, reg), team);
+            if (numTied == 0 || score > move.score) {
+                move.toReg = reg;
+                move.score = score;
+                numTied = 1;
+            }
+            else if (score == move.score) {
+                // Choose uniformly among the best candidates.
+                ++numTied;
+                std::uniform_int_distribution<int> pick(0, numTied - 1);
+                if (pick(randgen) == 0) {
+                    move.toReg = reg;
+                }
+            }
+        }
+    };
+
+    const int n = moves.size();
+    if (pool_) {
+        pool_->parallelFor(n, evaluate);
+    }
+    else {
+        for (int i = 0; i < n; ++i) {
+            evaluate(i);
+        }
+    }
+
+    return moves;
+}
@@ -0,0 +1,52 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef MOVE_PLANNER_H
+#define MOVE_PLANNER_H
+
+#include "InfluenceMap.h"
+#include <vector>
+
+class ThreadPool;
+
+struct PlannedMove
+{
+    int entityId;
+    int toReg;
+    int score;  // regions gained minus regions lost by the entity's team
+};
+
+
+// Simple AI.  For each entity on a team, try every region it could reach
+// this turn and pick the one that gains the team the most regions, assuming
+// nobody else moves.  Every candidate is scored against the same snapshot,
+// so entities can be evaluated in parallel.
+class MovePlanner
+{
+public:
+    // Entities can move up to 'moveRange' regions per turn.  Without a
+    // thread pool, planning runs on the calling thread.
+    explicit MovePlanner(int moveRange, ThreadPool *pool = nullptr);
+
+    // Plan one move per entity on 'team'.  Ties are broken using 'seed', so
+    // the same map and seed always give the same plan.  If 'budgetMs' is
+    // positive, entities not evaluated by then stay where they are, which
+    // makes the plan depend on timing.
+    std::vector<PlannedMove> plan(const InfluenceMap &map, int team,
+                                  unsigned int seed, int budgetMs = 0) const;
+
+private:
+    int moveRange_;
+    ThreadPool *pool_;
+};
+
+#endif
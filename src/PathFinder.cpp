@@ -0,0 +1,195 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "PathFinder.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+#include <utility>
+
+namespace
+{
+    // (priority, region), smallest priority first.
+    using QueueEntry = std::pair<int, int>;
+    using MinQueue = std::priority_queue<QueueEntry,
+                                         std::vector<QueueEntry>,
+                                         std::greater<QueueEntry>>;
+}
+
+const int PathFinder::impassable;
+
+PathFinder::PathFinder(const RegionGraph &graph, Heuristic h)
+    : graph_(graph),
+    heuristic_(std::move(h)),
+    costs_(graph.size(), 1),
+    costVersion_{0},
+    fields_{},
+    gScore_(graph.size(), 0),
+    cameFrom_(graph.size(), -1),
+    stamp_(graph.size(), 0),
+    search_{0}
+{
+}
+
+void PathFinder::setCost(int region, int cost)
+{
+    assert(region >= 0 && region < graph_.size());
+    assert(cost > 0 || cost == impassable);
+    if (costs_[region] != cost) {
+        costs_[region] = cost;
+        ++costVersion_;
+    }
+}
+
+int PathFinder::getCost(int region) const
+{
+    return costs_[region];
+}
+
+std::vector<int> PathFinder::findPath(int fromReg, int toReg)
+{
+    assert(fromReg >= 0 && fromReg < graph_.size());
+    assert(toReg >= 0 && toReg < graph_.size());
+    if (costs_[fromReg] == impassable || costs_[toReg] == impassable) {
+        return {};
+    }
+
+    ++search_;
+    MinQueue open;
+    gScore_[fromReg] = 0;
+    cameFrom_[fromReg] = -1;
+    stamp_[fromReg] = search_;
+    open.emplace(heuristic_ ? heuristic_(fromReg, toReg) : 0, fromReg);
+
+    while (!open.empty()) {
+        const auto cur = open.top().second;
+        const auto priority = open.top().first;
+        open.pop();
+        if (cur == toReg) {
+            break;
+        }
+
+        // Skip stale queue entries left behind by a cheaper path.
+        const auto g = gScore_[cur];
+        if (priority > g + (heuristic_ ? heuristic_(cur, toReg) : 0)) {
+            continue;
+        }
+
+        for (auto nbr : graph_.neighbors(cur)) {
+            const auto cost = costs_[nbr];
+            if (cost == impassable) {
+                continue;
+            }
+
+            const auto newG = g + cost;
+            if (stamp_[nbr] != search_ || newG < gScore_[nbr]) {
+                stamp_[nbr] = search_;
+                gScore_[nbr] = newG;
+                cameFrom_[nbr] = cur;
+                open.emplace(newG + (heuristic_ ? heuristic_(nbr, toReg) : 0),
+                             nbr);
+            }
+        }
+    }
+
+    if (stamp_[toReg] != search_) {
+        return {};
+    }
+
+    std::vector<int> path;
+    for (auto r = toReg; r != -1; r = cameFrom_[r]) {
+        path.push_back(r);
+    }
+    reverse(begin(path), end(path));
+    return path;
+}
+
+std::vector<int> PathFinder::pathTo(int fromReg, int toReg)
+{
+    const auto &dist = distanceField(toReg);
+    if (dist[fromReg] < 0) {
+        return {};
+    }
+
+    // Each step goes to a neighbor whose remaining distance accounts exactly
+    // for the cost of entering it.
+    std::vector<int> path(1, fromReg);
+    auto cur = fromReg;
+    while (cur != toReg) {
+        for (auto nbr : graph_.neighbors(cur)) {
+            if (dist[nbr] >= 0 && costs_[nbr] != impassable &&
+                dist[nbr] + costs_[nbr] == dist[cur])
+            {
+                cur = nbr;
+                break;
+            }
+        }
+        path.push_back(cur);
+    }
+    return path;
+}
+
+const std::vector<int> & PathFinder::distanceField(int toReg)
+{
+    assert(toReg >= 0 && toReg < graph_.size());
+    auto &field = fields_[toReg];
+    if (field.dist.empty() || field.version != costVersion_) {
+        computeField(toReg, field.dist);
+        field.version = costVersion_;
+    }
+    return field.dist;
+}
+
+void PathFinder::computeField(int toReg, std::vector<int> &dist) const
+{
+    dist.assign(graph_.size(), -1);
+    if (costs_[toReg] == impassable) {
+        return;
+    }
+
+    // Search backward from the target.  Moving from region r to a neighbor
+    // costs the neighbor's entry cost, so dist[r] = cost[n] + dist[n].
+    // Region graphs are symmetric, so r's neighbors are also the regions
+    // that can step into r.
+    MinQueue open;
+    dist[toReg] = 0;
+    open.emplace(0, toReg);
+    while (!open.empty()) {
+        const auto d = open.top().first;
+        const auto cur = open.top().second;
+        open.pop();
+        if (d > dist[cur] || costs_[cur] == impassable) {
+            continue;
+        }
+
+        for (auto nbr : graph_.neighbors(cur)) {
+            if (costs_[nbr] == impassable) {
+                continue;
+            }
+            const auto newDist = d + costs_[cur];
+            if (dist[nbr] < 0 || newDist < dist[nbr]) {
+                dist[nbr] = newDist;
+                open.emplace(newDist, nbr);
+            }
+        }
+    }
+}
+
+PathFinder::Heuristic makeGridHeuristic(int cols)
+{
+    return [cols] (int fromReg, int toReg) {
+        return abs(fromReg % cols - toReg % cols) +
+            abs(fromReg / cols - toReg / cols);
+    };
+}
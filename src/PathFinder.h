@@ -0,0 +1,85 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef PATH_FINDER_H
+#define PATH_FINDER_H
+
+#include "RegionGraph.h"
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// Movement paths over a region graph, where each region has a cost to enter.
+//
+// Single queries use A*.  When many units head for the same few objectives,
+// ask for the distance field of each objective instead: it's computed once
+// (Dijkstra outward from the target) and cached until a cost changes, after
+// which every path to that target is a walk downhill in O(path length).
+//
+// Not thread safe; give each thread its own PathFinder.
+class PathFinder
+{
+public:
+    // Lower bound on the cost of moving between two regions.  Leaving it out
+    // turns A* into plain Dijkstra, which is still correct but slower.
+    using Heuristic = std::function<int (int fromReg, int toReg)>;
+
+    static const int impassable = -1;
+
+    explicit PathFinder(const RegionGraph &graph, Heuristic h = Heuristic{});
+
+    // Every region costs 1 to enter until told otherwise.  Costs must be
+    // positive or impassable.
+    void setCost(int region, int cost);
+    int getCost(int region) const;
+
+    // Return the regions from 'fromReg' to 'toReg' inclusive, or an empty
+    // path if there isn't one.  Paths never start or end in an impassable
+    // region.
+    std::vector<int> findPath(int fromReg, int toReg);
+
+    // Same result as findPath, using (and caching) the distance field for
+    // 'toReg'.
+    std::vector<int> pathTo(int fromReg, int toReg);
+
+    // Cost of the cheapest path from each region to 'toReg', not counting
+    // the region you start in.  Unreachable regions are -1.
+    const std::vector<int> & distanceField(int toReg);
+
+private:
+    struct Field
+    {
+        unsigned int version;
+        std::vector<int> dist;
+    };
+
+    void computeField(int toReg, std::vector<int> &dist) const;
+
+    const RegionGraph &graph_;
+    Heuristic heuristic_;
+    std::vector<int> costs_;
+    unsigned int costVersion_;
+    std::unordered_map<int, Field> fields_;
+
+    // Scratch space for A*, reused between searches.  A region's entries are
+    // valid only if its stamp matches the current search.
+    std::vector<int> gScore_;
+    std::vector<int> cameFrom_;
+    std::vector<unsigned int> stamp_;
+    unsigned int search_;
+};
+
+// Manhattan distance between two regions of a grid made by makeGridGraph().
+// Admissible as long as no region costs less than 1.
+PathFinder::Heuristic makeGridHeuristic(int cols);
+
+#endif
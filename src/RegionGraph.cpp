@@ -0,0 +1,106 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "RegionGraph.h"
+#include <algorithm>
+#include <cassert>
+
+RegionGraph::RegionGraph()
+    : offsets_(1, 0),
+    neighbors_{}
+{
+}
+
+RegionGraph::RegionGraph(const std::vector<std::vector<int>> &adjacency)
+    : offsets_{},
+    neighbors_{}
+{
+    offsets_.reserve(adjacency.size() + 1);
+    offsets_.push_back(0);
+    for (const auto &nbrs : adjacency) {
+        neighbors_.insert(std::end(neighbors_), std::begin(nbrs), std::end(nbrs));
+        offsets_.push_back(neighbors_.size());
+    }
+}
+
+int RegionGraph::size() const
+{
+    return offsets_.size() - 1;
+}
+
+NeighborRange RegionGraph::neighbors(int reg) const
+{
+    assert(reg >= 0 && reg < size());
+    const auto data = neighbors_.data();
+    return {data + offsets_[reg], data + offsets_[reg + 1]};
+}
+
+int RegionGraph::numNeighbors(int reg) const
+{
+    assert(reg >= 0 && reg < size());
+    return offsets_[reg + 1] - offsets_[reg];
+}
+
+bool RegionGraph::areNeighbors(int reg1, int reg2) const
+{
+    const auto nbrs = neighbors(reg1);
+    return std::find(nbrs.begin(), nbrs.end(), reg2) != nbrs.end();
+}
+
+RegionGraph makeGridGraph(int cols, int rows)
+{
+    std::vector<std::vector<int>> adjacency(cols * rows);
+    for (int reg = 0; reg < cols * rows; ++reg) {
+        auto &nbrs = adjacency[reg];
+        if (reg >= cols) {
+            nbrs.push_back(reg - cols);
+        }
+        if ((reg + 1) % cols != 0) {
+            nbrs.push_back(reg + 1);
+        }
+        if (reg + cols < cols * rows) {
+            nbrs.push_back(reg + cols);
+        }
+        if (reg % cols != 0) {
+            nbrs.push_back(reg - 1);
+        }
+    }
+
+    return RegionGraph{adjacency};
+}
+
+RegionGraph makeHexGraph(int cols, int rows)
+{
+    // Column and row offsets to each neighbor, for even and odd columns.
+    const int evenOffsets[6][2] = {
+        {0, -1}, {1, -1}, {1, 0}, {0, 1}, {-1, 0}, {-1, -1}
+    };
+    const int oddOffsets[6][2] = {
+        {0, -1}, {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}
+    };
+
+    std::vector<std::vector<int>> adjacency(cols * rows);
+    for (int reg = 0; reg < cols * rows; ++reg) {
+        const int c = reg % cols;
+        const int r = reg / cols;
+        const auto &offsets = (c % 2 == 0) ? evenOffsets : oddOffsets;
+        for (const auto &off : offsets) {
+            const int nc = c + off[0];
+            const int nr = r + off[1];
+            if (nc >= 0 && nc < cols && nr >= 0 && nr < rows) {
+                adjacency[reg].push_back(nr * cols + nc);
+            }
+        }
+    }
+
+    return RegionGraph{adjacency};
+}
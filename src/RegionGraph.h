@@ -0,0 +1,57 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef REGION_GRAPH_H
+#define REGION_GRAPH_H
+
+#include <vector>
+
+// Iterable range of a region's neighbors.
+struct NeighborRange
+{
+    const int *first;
+    const int *last;
+
+    const int * begin() const { return first; }
+    const int * end() const { return last; }
+};
+
+
+// Which regions of a map border each other.  Regions are numbered from 0.
+// Neighbor lists are packed into one array so walking the graph doesn't
+// chase pointers.
+class RegionGraph
+{
+public:
+    RegionGraph();
+    explicit RegionGraph(const std::vector<std::vector<int>> &adjacency);
+
+    int size() const;
+    NeighborRange neighbors(int reg) const;
+    int numNeighbors(int reg) const;
+    bool areNeighbors(int reg1, int reg2) const;
+
+private:
+    std::vector<int> offsets_;  // region i's neighbors are [offsets_[i], offsets_[i+1])
+    std::vector<int> neighbors_;
+};
+
+// Regions laid out in a rectangular grid, numbered left to right and top to
+// bottom.  Each region has up to 4 neighbors, listed in N, E, S, W order.
+RegionGraph makeGridGraph(int cols, int rows);
+
+// Flat-topped hexes in columns, with odd columns shifted down half a hex.
+// Numbered left to right and top to bottom like the grid.  Each hex has up to
+// 6 neighbors, listed in N, NE, SE, S, SW, NW order.
+RegionGraph makeHexGraph(int cols, int rows);
+
+#endif
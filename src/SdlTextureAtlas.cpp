@@ -0,0 +1,225 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "SdlTextureAtlas.h"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+namespace
+{
+    // Leave a gap between images so scaled draws don't bleed into their
+    // neighbors.
+    const int padding = 1;
+}
+
+SdlTextureAtlas::SdlTextureAtlas(SdlWindow &win, int pageWidth, int pageHeight)
+    : win_(win),
+    pageWidth_{pageWidth},
+    pageHeight_{pageHeight},
+    pages_{},
+    known_{}
+{
+}
+
+AtlasSprite SdlTextureAtlas::add(const SdlSurface &surf)
+{
+    assert(surf);
+    auto iter = known_.find(surf.get());
+    if (iter != std::end(known_)) {
+        return iter->second.second;
+    }
+
+    auto sprite = allocate(surf->w, surf->h);
+    if (sprite.page < 0) {
+        return sprite;
+    }
+
+    // Copy the pixels as-is, including alpha, rather than blending them onto
+    // the blank page.
+    auto &page = pages_[sprite.page];
+    auto dest = sprite.rect;
+    SDL_BlendMode origBlend;
+    SDL_GetSurfaceBlendMode(surf.get(), &origBlend);
+    SDL_SetSurfaceBlendMode(surf.get(), SDL_BLENDMODE_NONE);
+    if (SDL_BlitSurface(surf.get(), nullptr, page.pixels.get(), &dest) < 0) {
+        std::cerr << "Error copying image to atlas: " << SDL_GetError();
+    }
+    SDL_SetSurfaceBlendMode(surf.get(), origBlend);
+
+    const auto bpp = page.pixels->format->BytesPerPixel;
+    auto pixels = static_cast<Uint8 *>(page.pixels->pixels) +
+        sprite.rect.y * page.pixels->pitch + sprite.rect.x * bpp;
+    SDL_UpdateTexture(page.tex.get(), &sprite.rect, pixels,
+                      page.pixels->pitch);
+
+    known_.insert(std::make_pair(surf.get(), std::make_pair(surf, sprite)));
+    return sprite;
+}
+
+void SdlTextureAtlas::drawCentered(const AtlasSprite &sprite,
+                                   const SDL_Point &p,
+                                   double zoom)
+{
+    if (sprite.page < 0) {
+        return;  // image failed to load into the atlas
+    }
+
+    assert(sprite.page < numPages());
+    auto &page = pages_[sprite.page];
+    page.srcQueue.push_back(sprite.rect);
+    const auto w = static_cast<int>(sprite.rect.w * zoom);
+    const auto h = static_cast<int>(sprite.rect.h * zoom);
+    page.destQueue.push_back({p.x - w / 2, p.y - h / 2, w, h});
+}
+
+void SdlTextureAtlas::flush()
+{
+    for (auto &page : pages_) {
+        if (!page.destQueue.empty()) {
+            flushPage(page);
+        }
+        page.srcQueue.clear();
+        page.destQueue.clear();
+    }
+}
+
+int SdlTextureAtlas::numPages() const
+{
+    return pages_.size();
+}
+
+AtlasSprite SdlTextureAtlas::allocate(int w, int h)
+{
+    const int paddedW = w + padding;
+    const int paddedH = h + padding;
+
+    // Images too big for a normal page get a page of their own.
+    if (paddedW > pageWidth_ || paddedH > pageHeight_) {
+        return {addPage(w, h), {0, 0, w, h}};
+    }
+
+    // Simple shelf packing: fill rows left to right, start a new row below
+    // the tallest image when the current one runs out of room.
+    for (int i = 0; i < numPages(); ++i) {
+        auto &page = pages_[i];
+        if (page.pixels->w != pageWidth_ || page.pixels->h != pageHeight_) {
+            continue;  // dedicated page for an oversized image
+        }
+
+        if (page.nextX + paddedW > pageWidth_) {
+            page.shelfY += page.shelfH;
+            page.shelfH = 0;
+            page.nextX = 0;
+        }
+        if (page.shelfY + paddedH > pageHeight_) {
+            continue;
+        }
+
+        AtlasSprite sprite = {i, {page.nextX, page.shelfY, w, h}};
+        page.nextX += paddedW;
+        page.shelfH = std::max(page.shelfH, paddedH);
+        return sprite;
+    }
+
+    const int newPage = addPage(pageWidth_, pageHeight_);
+    if (newPage < 0) {
+        return {-1, {0, 0, 0, 0}};
+    }
+    return allocate(w, h);
+}
+
+int SdlTextureAtlas::addPage(int w, int h)
+{
+    auto surf = SDL_CreateRGBSurface(0, w, h, 32,
+                                     0x00ff0000,
+                                     0x0000ff00,
+                                     0x000000ff,
+                                     0xff000000);
+    if (!surf) {
+        std::cerr << "Error creating atlas page: " << SDL_GetError();
+        return -1;
+    }
+    SDL_FillRect(surf, nullptr, SDL_MapRGBA(surf->format, 0, 0, 0,
+                                            SDL_ALPHA_TRANSPARENT));
+
+    auto tex = SDL_CreateTexture(win_.getRenderer(),
+                                 SDL_PIXELFORMAT_ARGB8888,
+                                 SDL_TEXTUREACCESS_STATIC,
+                                 w,
+                                 h);
+    if (!tex) {
+        std::cerr << "Error creating atlas texture: " << SDL_GetError();
+        SDL_FreeSurface(surf);
+        return -1;
+    }
+    SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+    SDL_UpdateTexture(tex, nullptr, surf->pixels, surf->pitch);
+
+    Page page;
+    page.pixels = make_surface(surf);
+    page.tex = SdlTexture{tex, win_, w, h};
+    page.shelfY = 0;
+    page.shelfH = 0;
+    page.nextX = 0;
+    pages_.push_back(std::move(page));
+    return numPages() - 1;
+}
+
+void SdlTextureAtlas::flushPage(Page &page)
+{
+    assert(page.srcQueue.size() == page.destQueue.size());
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    // Two triangles per sprite, all submitted in a single call.
+    const float texW = page.tex.width();
+    const float texH = page.tex.height();
+    const SDL_Color white = {255, 255, 255, SDL_ALPHA_OPAQUE};
+    vertices_.clear();
+    indices_.clear();
+    for (std::size_t i = 0; i < page.destQueue.size(); ++i) {
+        const auto &src = page.srcQueue[i];
+        const auto &dest = page.destQueue[i];
+        const float u1 = src.x / texW;
+        const float v1 = src.y / texH;
+        const float u2 = (src.x + src.w) / texW;
+        const float v2 = (src.y + src.h) / texH;
+        const float x1 = dest.x;
+        const float y1 = dest.y;
+        const float x2 = dest.x + dest.w;
+        const float y2 = dest.y + dest.h;
+
+        const int first = vertices_.size();
+        vertices_.push_back({{x1, y1}, white, {u1, v1}});
+        vertices_.push_back({{x2, y1}, white, {u2, v1}});
+        vertices_.push_back({{x2, y2}, white, {u2, v2}});
+        vertices_.push_back({{x1, y2}, white, {u1, v2}});
+        const int quad[] = {0, 1, 2, 0, 2, 3};
+        for (auto q : quad) {
+            indices_.push_back(first + q);
+        }
+    }
+
+    if (SDL_RenderGeometry(win_.getRenderer(), page.tex.get(),
+                           vertices_.data(), vertices_.size(),
+                           indices_.data(), indices_.size()) < 0)
+    {
+        std::cerr << "Error drawing atlas batch: " << SDL_GetError();
+    }
+#else
+    // Older SDL has no geometry API.  Consecutive copies from the same
+    // texture are still the cheapest case for the renderer.
+    for (std::size_t i = 0; i < page.destQueue.size(); ++i) {
+        page.tex.drawZoomed(page.destQueue[i], &page.srcQueue[i]);
+    }
+#endif
+}
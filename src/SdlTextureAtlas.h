@@ -0,0 +1,83 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef SDL_TEXTURE_ATLAS_H
+#define SDL_TEXTURE_ATLAS_H
+
+#include "SdlTexture.h"
+#include "SdlWindow.h"
+#include "sdl_utils.h"
+#include <map>
+#include <vector>
+
+// Location of one image inside the atlas.
+struct AtlasSprite
+{
+    int page;
+    SDL_Rect rect;
+};
+
+
+// Many small images packed into a few large textures.  Draws are queued up
+// and submitted one batch per texture page, so the number of render calls
+// doesn't grow with the number of sprites on screen.
+class SdlTextureAtlas
+{
+public:
+    SdlTextureAtlas(SdlWindow &win, int pageWidth = 1024,
+                    int pageHeight = 1024);
+
+    // Copy an image into the atlas.  Adding the same surface twice returns
+    // the existing sprite.  Returns page -1 on failure.
+    AtlasSprite add(const SdlSurface &surf);
+
+    // Queue a sprite to be drawn using (px,py) as the center point,
+    // optionally scaled up (> 1.0) or down (< 1.0).
+    void drawCentered(const AtlasSprite &sprite, const SDL_Point &p,
+                      double zoom = 1.0);
+
+    // Draw everything queued since the last flush.  Sprites on the same page
+    // keep their relative order, but pages are drawn one after another.
+    void flush();
+
+    int numPages() const;
+
+private:
+    struct Page
+    {
+        SdlSurface pixels;
+        SdlTexture tex;
+        int shelfY;  // top of the shelf currently being filled
+        int shelfH;  // height of the tallest image on that shelf
+        int nextX;
+        std::vector<SDL_Rect> srcQueue;
+        std::vector<SDL_Rect> destQueue;
+    };
+
+    // Find room for a w x h image, adding a new page if necessary.
+    AtlasSprite allocate(int w, int h);
+    int addPage(int w, int h);
+
+    void flushPage(Page &page);
+
+    SdlWindow &win_;
+    int pageWidth_;
+    int pageHeight_;
+    std::vector<Page> pages_;
+    std::map<SDL_Surface *, std::pair<SdlSurface, AtlasSprite>> known_;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    std::vector<SDL_Vertex> vertices_;
+    std::vector<int> indices_;
+#endif
+};
+
+#endif
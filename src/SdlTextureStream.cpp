@@ -42,6 +42,12 @@ void SdlTextureStream::draw(int px, int py)
     tex_.draw(px, py);
 }
 
+void SdlTextureStream::drawZoomed(const SDL_Rect &destRect,
+                                  const SDL_Rect *srcRect)
+{
+    tex_.drawZoomed(destRect, srcRect);
+}
+
 SdlTextureStream::operator bool() const
 {
     return static_cast<bool>(tex_);
@@ -28,6 +28,9 @@ public:
     void update(const SdlSurface &surf);
     void draw(int px, int py);
 
+    // Draw (a portion of) the texture scaled to fit the destination rectangle.
+    void drawZoomed(const SDL_Rect &destRect, const SDL_Rect *srcRect = nullptr);
+
     explicit operator bool() const;
     SDL_Texture * get();
 
@@ -13,93 +13,305 @@
 #include "SimpleMap.h"
 #include <algorithm>
 #include <array>
+#include <cassert>
+#include <cmath>
 #include <iostream> //TODO
 
 namespace
 {
     const int xRegions = 8;
     const int yRegions = 4;
+    const int hexWidth = 256;
+    const int sightRadius = 2;
+
+    // Heatmap cells are this many map pixels on a side.  Influence reaches
+    // about a region and a half from its source.
+    const int heatCellSize = 32;
+    const int heatRadiusX2 = 3;  // in regions, times 2
     const SDL_Point xyInvalid = {-1, -1};
 
-    std::array<int, 4> regionNeighbors(int reg)
-    {
-        std::array<int, 4> nbrs;
-        nbrs.fill(-1);
+    // Neighboring pixels, in the order we check them for region borders.
+    const std::array<SDL_Point, 8> pixelNeighbors = {{
+        {0, -1}, {1, -1}, {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}
+    }};
+}
 
-        const int regN = reg - xRegions;
-        if (regN >= 0) {
-            nbrs[0] = regN;
-        }
-        const int regE = reg + 1;
-        if (regE % xRegions != 0) {
-            nbrs[1] = regE;
-        }
-        const int regS = reg + xRegions;
-        if (regS < xRegions * yRegions) {
-            nbrs[2] = regS;
-        }
-        const int regW = reg - 1;
-        if (reg % xRegions != 0) {
-            nbrs[3] = regW;
-        }
+SimpleMap::SimpleMap(int width, int height, MapShape shape, int numTeams,
+                     int numLevels, ThreadPool *pool, unsigned int seed)
+    : width_{width},
+    height_{height},
+    shape_{shape},
+    seed_{seed},
+    hexes_{shape == MapShape::HEX ? HexGrid::fit(width, height, hexWidth) :
+           HexGrid{}},
+    cells_{shape == MapShape::VORONOI ?
+           makeVoronoi(randomCenters(width, height, seed), width, height) :
+           std::vector<VoronoiCell>{}},
+    influence_{makeGraph(), numTeams},
+    visibility_{influence_.graph(), numTeams, sightRadius},
+    viewer_{-1},
+    dirtyRegions_{},
+    levels_{},
+    style_{MapStyle::FLAT},
+    heat_{(width + heatCellSize - 1) / heatCellSize,
+          (height + heatCellSize - 1) / heatCellSize,
+          numTeams,
+          regionWidth() * heatRadiusX2 / 2 / heatCellSize,
+          pool},
+    heatColors_(heat_.cols() * heat_.rows(), GREY),
+    teamColors_{},
+    heatScale_{1},
+    movedRegions_{},
+    heatDirty_{},
+    isHeatAllDirty_{false},
+    scratch_{}
+{
+    assert(numLevels > 0);
+    for (int t = 0; t < numTeams; ++t) {
+        teamColors_.push_back(teamColor(t));
+    }
+
+    // Every region can change at once, but no more, so update() never needs
+    // to grow this.
+    dirtyRegions_.reserve(influence_.numRegions());
 
-        return nbrs;
+    for (int i = 0; i < numLevels; ++i) {
+        levels_.push_back(shape_ == MapShape::VORONOI ? buildPolygonLevel(i) :
+                          buildLevel(i));
     }
 }
 
-SimpleMap::SimpleMap(int width, int height, int numTeams,
-                     const SdlSurface &blankUpdateSurf)
-    : width_{width},
-    height_{height},
-    numTeams_{numTeams},
-    influence_(xRegions * yRegions * numTeams_, 0),
-    entities_{},
-    updateSurf_{blankUpdateSurf}
+int SimpleMap::width(int level) const
 {
+    assert(level >= 0 && level < numLevels());
+    return levels_[level].width;
 }
 
-SdlSurface SimpleMap::update()
+int SimpleMap::height(int level) const
 {
-    relaxInfluence();
+    assert(level >= 0 && level < numLevels());
+    return levels_[level].height;
+}
+
+int SimpleMap::numLevels() const
+{
+    return levels_.size();
+}
 
-    SdlLockSurface guard{updateSurf_};
-    auto p = static_cast<Uint8 *>(updateSurf_->pixels);
-    const auto bpp = updateSurf_->format->BytesPerPixel;
-    for (int i = 0; i < width_ * height_; ++i, p += bpp) {
-        sdlSetPixel(updateSurf_, p, getColor(i));
+MapShape SimpleMap::shape() const
+{
+    return shape_;
+}
+
+unsigned int SimpleMap::seed() const
+{
+    return seed_;
+}
+
+const InfluenceMap & SimpleMap::influence() const
+{
+    return influence_;
+}
+
+void SimpleMap::setViewer(int team)
+{
+    assert(team >= -1 && team < influence_.numTeams());
+    viewer_ = team;
+}
+
+int SimpleMap::viewer() const
+{
+    return viewer_;
+}
+
+bool SimpleMap::isVisible(int region) const
+{
+    return viewer_ < 0 || visibility_.isVisible(viewer_, region);
+}
+
+void SimpleMap::setStyle(MapStyle style)
+{
+    style_ = style;
+    if (style_ == MapStyle::HEATMAP) {
+        updateHeat();
+    }
+    movedRegions_.clear();
+    heatDirty_.clear();
+}
+
+MapStyle SimpleMap::style() const
+{
+    return style_;
+}
+
+void SimpleMap::update()
+{
+    influence_.update();
+
+    // Every move changes the heatmap around where the entity left and where
+    // it arrived.
+    heatDirty_.clear();
+    isHeatAllDirty_ = false;
+    if (style_ == MapStyle::HEATMAP) {
+        const auto oldScale = heatScale_;
+        updateHeat();
+        isHeatAllDirty_ = (heatScale_ != oldScale);
+
+        // Cells within the radius of the entity's cell change.  Pixels blend
+        // the four nearest cell centers, so pixels up to half a cell past
+        // the last changed cell do too.  Rounding that up to a whole cell
+        // also covers wherever the entity sits inside its own cell.
+        const int reach = (heat_.radius() + 2) * heatCellSize;
+        for (auto r : movedRegions_) {
+            const auto p = pixelFromRegion(r);
+            heatDirty_.push_back({p.x - reach, p.y - reach,
+                                  2 * reach, 2 * reach});
+        }
+    }
+    movedRegions_.clear();
+
+    dirtyRegions_ = influence_.changedRegions();
+    if (viewer_ >= 0) {
+        const auto &seen = visibility_.changedRegions(viewer_);
+        dirtyRegions_.insert(end(dirtyRegions_), begin(seen), end(seen));
+        sort(begin(dirtyRegions_), end(dirtyRegions_));
+        dirtyRegions_.erase(unique(begin(dirtyRegions_), end(dirtyRegions_)),
+                            end(dirtyRegions_));
+    }
+    visibility_.clearChanges();
+}
+
+void SimpleMap::dirtyRects(int level, std::vector<SDL_Rect> &rects) const
+{
+    assert(level >= 0 && level < numLevels());
+    const auto &lvl = levels_[level];
+    const SDL_Rect levelRect = {0, 0, lvl.width, lvl.height};
+
+    // Border colors depend on both regions, so include the neighbors' border
+    // pixels just outside each changed region.
+    rects.clear();
+    for (auto r : dirtyRegions_) {
+        const auto &bounds = lvl.regionBounds[r];
+        if (bounds.w == 0 || bounds.h == 0) {
+            continue;  // region too small to appear at this level
+        }
+
+        const SDL_Rect grown = {bounds.x - 1,
+                                bounds.y - 1,
+                                bounds.w + 2,
+                                bounds.h + 2};
+        SDL_Rect clipped;
+        if (SDL_IntersectRect(&grown, &levelRect, &clipped)) {
+            rects.push_back(clipped);
+        }
+    }
+
+    if (isHeatAllDirty_) {
+        rects.assign(1, levelRect);
+        return;
+    }
+    const int scale = 1 << level;
+    for (const auto &mapRect : heatDirty_) {
+        const SDL_Rect scaled = {mapRect.x / scale,
+                                 mapRect.y / scale,
+                                 mapRect.w / scale + 2,
+                                 mapRect.h / scale + 2};
+        SDL_Rect clipped;
+        if (SDL_IntersectRect(&scaled, &levelRect, &clipped)) {
+            rects.push_back(clipped);
+        }
     }
+}
 
-    return updateSurf_;
+void SimpleMap::drawTile(int level, const SDL_Rect &levelRect,
+                         SdlSurface &dest) const
+{
+    assert(level >= 0 && level < numLevels());
+    assert(levelRect.w <= dest->w && levelRect.h <= dest->h);
+    if (shape_ == MapShape::VORONOI) {
+        drawCells(level, levelRect, dest);
+        return;
+    }
+    const auto &lvl = levels_[level];
+
+    SdlLockSurface guard{dest};
+    const auto bpp = dest->format->BytesPerPixel;
+    const int scale = 1 << level;
+    for (int y = 0; y < levelRect.h; ++y) {
+        auto p = static_cast<Uint8 *>(dest->pixels) + y * dest->pitch;
+        auto a = (levelRect.y + y) * lvl.width + levelRect.x;
+        if (style_ == MapStyle::HEATMAP) {
+            const int mapY = (levelRect.y + y) * scale + scale / 2;
+            for (int x = 0; x < levelRect.w; ++x, ++a, p += bpp) {
+                const int mapX = (levelRect.x + x) * scale + scale / 2;
+                sdlSetPixel(dest, p, getHeatColor(lvl, a, mapX, mapY));
+            }
+        }
+        else {
+            for (int x = 0; x < levelRect.w; ++x, ++a, p += bpp) {
+                sdlSetPixel(dest, p, getColor(lvl, a));
+            }
+        }
+    }
 }
 
 void SimpleMap::addEntity(MapEntity entity)
 {
-    // TODO: this needs to be sorted
-    entities_.push_back(entity);
+    influence_.addEntity(entity);
+    visibility_.addEntity(entity);
 }
 
 void SimpleMap::moveEntity(int id, int toReg)
 {
-    auto entity = findEntity(id);
-    if (entity) {
-        entity->region = toReg;
+    auto entity = influence_.findEntity(id);
+    if (!entity) {
+        return;
     }
+
+    movedRegions_.push_back(entity->region);
+    movedRegions_.push_back(toReg);
+    heatDirty_.reserve(movedRegions_.size());  // make room before update()
+    visibility_.moveEntity(*entity, toReg);
+    influence_.moveEntity(id, toReg);
 }
 
-int SimpleMap::getRegion(int entityId) const
+bool SimpleMap::restore(InfluenceState state)
 {
-    auto entity = findEntity(entityId);
-    if (!entity) {
-        return -1;
+    if (!influence_.restore(std::move(state))) {
+        return false;
+    }
+
+    visibility_.clear();
+    for (const auto &e : influence_.entities()) {
+        visibility_.addEntity(e);
+    }
+    visibility_.clearChanges();
+    movedRegions_.clear();
+    heatDirty_.clear();
+    dirtyRegions_ = influence_.changedRegions();
+    if (style_ == MapStyle::HEATMAP) {
+        updateHeat();
     }
-    return entity->region;
+    isHeatAllDirty_ = true;
+    return true;
+}
+
+int SimpleMap::getRegion(int entityId) const
+{
+    return influence_.getRegion(entityId);
 }
 
 SDL_Point SimpleMap::pixelFromRegion(int reg) const
 {
-    if (reg < 0 || reg >= xRegions * yRegions) {
+    if (reg < 0 || reg >= influence_.numRegions()) {
         return xyInvalid;
     }
+    if (shape_ == MapShape::HEX) {
+        return hexes_.centerPixel(reg);
+    }
+    if (shape_ == MapShape::VORONOI) {
+        return {cells_[reg].center.x, cells_[reg].center.y};
+    }
 
     const int rx = reg % xRegions;
     const int ry = reg / xRegions;
@@ -108,13 +320,17 @@ SDL_Point SimpleMap::pixelFromRegion(int reg) const
     return {rx * rWidth + rWidth / 2, ry * rHeight + rHeight / 2};
 }
 
-SDL_Point SimpleMap::pixelFromAry(int a) const
+int SimpleMap::regionAt(const SDL_Point &p) const
 {
-    if (a < 0 || a >= width_ * height_) {
-        return xyInvalid;
+    if (shape_ == MapShape::VORONOI) {
+        return regionFromPixel(p);
     }
 
-    return {a % width_, a / width_};
+    const auto &lvl = levels_[0];
+    if (p.x < 0 || p.x >= lvl.width || p.y < 0 || p.y >= lvl.height) {
+        return -1;
+    }
+    return lvl.labels[p.y * lvl.width + p.x];
 }
 
 int SimpleMap::regionFromPixel(const SDL_Point &p) const
@@ -122,62 +338,238 @@ int SimpleMap::regionFromPixel(const SDL_Point &p) const
     if (p.x < 0 || p.x >= width_ || p.y < 0 || p.y >= height_) {
         return -1;
     }
+    if (shape_ == MapShape::HEX) {
+        return hexes_.hexFromPixel(p);
+    }
+    if (shape_ == MapShape::VORONOI) {
+        // By definition, the nearest center.
+        int best = -1;
+        long long bestDist = 0;
+        for (int r = 0; r < static_cast<int>(cells_.size()); ++r) {
+            const long long dx = p.x - cells_[r].center.x;
+            const long long dy = p.y - cells_[r].center.y;
+            const auto dist = dx * dx + dy * dy;
+            if (best < 0 || dist < bestDist) {
+                best = r;
+                bestDist = dist;
+            }
+        }
+        return best;
+    }
 
     const int rx = p.x * xRegions / width_;
     const int ry = p.y * yRegions / height_;
     return ry * xRegions + rx;
 }
 
-int SimpleMap::regionFromAry(int a) const
+RegionGraph SimpleMap::makeGraph() const
 {
-    return regionFromPixel(pixelFromAry(a));
+    switch (shape_) {
+        case MapShape::HEX:
+            return makeHexGraph(hexes_.cols(), hexes_.rows());
+        case MapShape::VORONOI:
+            return graphFromVoronoi(cells_);
+        default:
+            return makeGridGraph(xRegions, yRegions);
+    }
 }
 
-SDL_Color SimpleMap::getColor(int a) const
+MapLevel SimpleMap::buildLevel(int level) const
 {
-    const auto reg = regionFromAry(a);
-    const auto p = pixelFromAry(a);
-
-    const auto regN = regionFromPixel({p.x, p.y - 1});
-    if (regN != -1 && regN != reg) {
-        return getBorderColor(reg, regN);
-    }
-    const auto regNE = regionFromPixel({p.x + 1, p.y - 1});
-    if (regNE != -1 && regNE != reg) {
-        return getBorderColor(reg, regNE);
+    const int scale = 1 << level;
+    MapLevel lvl;
+    lvl.width = (width_ + scale - 1) / scale;
+    lvl.height = (height_ + scale - 1) / scale;
+    const int size = lvl.width * lvl.height;
+
+    lvl.labels.resize(size);
+    for (int y = 0, a = 0; y < lvl.height; ++y) {
+        const int mapY = std::min(y * scale + scale / 2, height_ - 1);
+        for (int x = 0; x < lvl.width; ++x, ++a) {
+            const int mapX = std::min(x * scale + scale / 2, width_ - 1);
+            lvl.labels[a] = regionFromPixel({mapX, mapY});
+        }
     }
-    const auto regE = regionFromPixel({p.x + 1, p.y});
-    if (regE != -1 && regE != reg) {
-        return getBorderColor(reg, regE);
+
+    // Borders are found at this level's own resolution so they stay one
+    // pixel wide at every zoom.
+    const int numRegions = influence_.numRegions();
+    std::vector<SDL_Point> minXY(numRegions, SDL_Point{lvl.width, lvl.height});
+    std::vector<SDL_Point> maxXY(numRegions, SDL_Point{-1, -1});
+    lvl.borders.assign(size, 0);
+    for (int y = 0, a = 0; y < lvl.height; ++y) {
+        for (int x = 0; x < lvl.width; ++x, ++a) {
+            const auto reg = lvl.labels[a];
+            for (int d = 0; d < static_cast<int>(pixelNeighbors.size()); ++d) {
+                const auto nx = x + pixelNeighbors[d].x;
+                const auto ny = y + pixelNeighbors[d].y;
+                if (nx < 0 || nx >= lvl.width || ny < 0 || ny >= lvl.height) {
+                    continue;
+                }
+                if (lvl.labels[ny * lvl.width + nx] != reg) {
+                    lvl.borders[a] = d + 1;
+                    break;
+                }
+            }
+
+            minXY[reg].x = std::min(minXY[reg].x, x);
+            minXY[reg].y = std::min(minXY[reg].y, y);
+            maxXY[reg].x = std::max(maxXY[reg].x, x);
+            maxXY[reg].y = std::max(maxXY[reg].y, y);
+        }
     }
-    const auto regSE = regionFromPixel({p.x + 1, p.y + 1});
-    if (regSE != -1 && regSE != reg) {
-        return getBorderColor(reg, regSE);
+
+    lvl.regionBounds.assign(numRegions, SDL_Rect{0, 0, 0, 0});
+    for (int r = 0; r < numRegions; ++r) {
+        if (maxXY[r].x >= 0) {
+            lvl.regionBounds[r] = {minXY[r].x,
+                                   minXY[r].y,
+                                   maxXY[r].x - minXY[r].x + 1,
+                                   maxXY[r].y - minXY[r].y + 1};
+        }
     }
-    const auto regS = regionFromPixel({p.x, p.y + 1});
-    if (regS != -1 && regS != reg) {
-        return getBorderColor(reg, regS);
+
+    return lvl;
+}
+
+MapLevel SimpleMap::buildPolygonLevel(int level) const
+{
+    const double scale = 1 << level;
+    MapLevel lvl;
+    lvl.width = static_cast<int>(std::ceil(width_ / scale));
+    lvl.height = static_cast<int>(std::ceil(height_ / scale));
+
+    // Bounding boxes include every pixel the cell might touch, plus the
+    // border pixels on either side of its edges.
+    for (const auto &cell : cells_) {
+        if (cell.vertices.empty()) {
+            lvl.regionBounds.push_back({0, 0, 0, 0});
+            continue;
+        }
+
+        auto xMin = cell.vertices[0].x;
+        auto xMax = xMin;
+        auto yMin = cell.vertices[0].y;
+        auto yMax = yMin;
+        for (const auto &v : cell.vertices) {
+            xMin = std::min(xMin, v.x);
+            xMax = std::max(xMax, v.x);
+            yMin = std::min(yMin, v.y);
+            yMax = std::max(yMax, v.y);
+        }
+        const int x1 = static_cast<int>(std::floor(xMin / scale));
+        const int y1 = static_cast<int>(std::floor(yMin / scale));
+        const int x2 = static_cast<int>(std::ceil(xMax / scale));
+        const int y2 = static_cast<int>(std::ceil(yMax / scale));
+        lvl.regionBounds.push_back({x1, y1, x2 - x1 + 1, y2 - y1 + 1});
     }
-    const auto regSW = regionFromPixel({p.x - 1, p.y + 1});
-    if (regSW != -1 && regSW != reg) {
-        return getBorderColor(reg, regSW);
+
+    return lvl;
+}
+
+void SimpleMap::drawCells(int level, const SDL_Rect &levelRect,
+                          SdlSurface &dest) const
+{
+    const auto &lvl = levels_[level];
+    const double scale = 1 << level;
+
+    // Rounding can leave the odd pixel between cells uncovered.
+    SDL_Rect destRect = {0, 0, levelRect.w, levelRect.h};
+    SDL_FillRect(dest.get(), &destRect,
+                 SDL_MapRGB(dest->format, BLACK.r, BLACK.g, BLACK.b));
+
+    SdlLockSurface guard{dest};
+    const auto bpp = dest->format->BytesPerPixel;
+    FrameArena::Scope scope{scratch_};
+    auto spans = scratch_.alloc<CellSpan>(levelRect.h + 2);
+    for (int r = 0; r < static_cast<int>(cells_.size()); ++r) {
+        const auto &bounds = lvl.regionBounds[r];
+        if (!SDL_HasIntersection(&bounds, &levelRect)) {
+            continue;
+        }
+
+        // Rows above and below the tile decide which pixels on its top and
+        // bottom rows are borders.
+        const auto &cell = cells_[r];
+        for (int i = 0; i < levelRect.h + 2; ++i) {
+            spans[i] = cellSpan(cell, scale, levelRect.y + i - 1);
+        }
+
+        const bool isSeen = isVisible(r);
+        for (int i = 1; i <= levelRect.h; ++i) {
+            const auto &span = spans[i];
+            const int y = levelRect.y + i - 1;
+            const int x1 = std::max(span.x1, levelRect.x);
+            const int x2 = std::min(span.x2, levelRect.x + levelRect.w);
+            if (x1 >= x2) {
+                continue;
+            }
+
+            // A pixel is on the border if any of its four neighbors on the
+            // map belongs to another cell.
+            const auto &above = spans[i - 1];
+            const auto &below = spans[i + 1];
+            const bool isTop = (y == 0);
+            const bool isBottom = (y == lvl.height - 1);
+            auto p = static_cast<Uint8 *>(dest->pixels) +
+                (y - levelRect.y) * dest->pitch + (x1 - levelRect.x) * bpp;
+            const int mapY = static_cast<int>((y + 0.5) * scale);
+            for (int x = x1; x < x2; ++x, p += bpp) {
+                const bool isBorder =
+                    (x == span.x1 && x > 0) ||
+                    (x == span.x2 - 1 && x < lvl.width - 1) ||
+                    (!isTop && (x < above.x1 || x >= above.x2)) ||
+                    (!isBottom && (x < below.x1 || x >= below.x2));
+                const int mapX = static_cast<int>((x + 0.5) * scale);
+
+                SDL_Color color;
+                if (!isSeen) {
+                    color = isBorder ? BORDER_BG : FOG;
+                }
+                else if (isBorder) {
+                    color = getBorderColor(r, nearestNeighbor(r, mapX, mapY));
+                }
+                else if (style_ == MapStyle::HEATMAP) {
+                    color = sampleHeat(mapX, mapY);
+                }
+                else {
+                    color = GREY;
+                }
+                sdlSetPixel(dest, p, color);
+            }
+        }
     }
-    const auto regW = regionFromPixel({p.x - 1, p.y});
-    if (regW != -1 && regW != reg) {
-        return getBorderColor(reg, regW);
+}
+
+SDL_Color SimpleMap::getColor(const MapLevel &level, int a) const
+{
+    const auto dir = level.borders[a];
+    const bool isSeen = isVisible(level.labels[a]);
+    if (dir == 0) {
+        return isSeen ? GREY : FOG;
     }
-    const auto regNW = regionFromPixel({p.x - 1, p.y - 1});
-    if (regNW != -1 && regNW != reg) {
-        return getBorderColor(reg, regNW);
+    if (!isSeen) {
+        return BORDER_BG;
     }
 
-    return GREY;
+    const auto &offset = pixelNeighbors[dir - 1];
+    const auto nbr = level.labels[a + offset.y * level.width + offset.x];
+    return getBorderColor(level.labels[a], nbr);
+}
+
+SDL_Color SimpleMap::getHeatColor(const MapLevel &level, int a,
+                                  int mapX, int mapY) const
+{
+    if (level.borders[a] != 0 || !isVisible(level.labels[a])) {
+        return getColor(level, a);
+    }
+    return sampleHeat(mapX, mapY);
 }
 
 SDL_Color SimpleMap::getBorderColor(int reg1, int reg2) const
 {
-    const auto owner1 = getOwner(reg1);
-    const auto owner2 = getOwner(reg2);
+    const auto owner1 = visibleOwner(reg1);
+    const auto owner2 = visibleOwner(reg2);
 
     if (owner1 == owner2) {
         if (owner1 != -1) {
@@ -188,67 +580,122 @@ SDL_Color SimpleMap::getBorderColor(int reg1, int reg2) const
         }
     }
     else if (owner1 == -1) {
-        return teamColors[owner2];
+        return teamColor(owner2);
     }
 
-    return teamColors[owner1];
+    return teamColor(owner1);
 }
 
-int SimpleMap::getOwner(int region) const
+int SimpleMap::nearestNeighbor(int region, int mapX, int mapY) const
 {
-    auto maxInfl = 0;
-    auto owner = -1;
-    auto team = 0;
-    for (int i = region * numTeams_; i < (region + 1) * numTeams_; ++i, ++team) {
-        if (influence_[i] > maxInfl) {
-            maxInfl = influence_[i];
-            owner = team;
-        }
-        else if (influence_[i] == maxInfl) {
-            owner = -1;
+    // A border pixel is next to whichever neighboring cell's center is
+    // closest to it.
+    int best = region;
+    long long bestDist = 0;
+    for (auto nbr : influence_.graph().neighbors(region)) {
+        const long long dx = mapX - cells_[nbr].center.x;
+        const long long dy = mapY - cells_[nbr].center.y;
+        const auto dist = dx * dx + dy * dy;
+        if (best == region || dist < bestDist) {
+            best = nbr;
+            bestDist = dist;
         }
     }
-
-    return owner;
-}
-
-int SimpleMap::teamOffset(int region, Team team) const
-{
-    return region * numTeams_ + static_cast<int>(team);
+    return best;
 }
 
-void SimpleMap::addInfluence(int region, Team team, int value)
+int SimpleMap::visibleOwner(int region) const
 {
-    influence_[teamOffset(region, team)] += value;
+    if (!isVisible(region)) {
+        return -1;
+    }
+    return influence_.getOwner(region);
 }
 
-void SimpleMap::relaxInfluence()
+void SimpleMap::updateHeat()
 {
-    fill(begin(influence_), end(influence_), 0);
-
-    for (const auto &e : entities_) {
-        addInfluence(e.region, e.team, e.influence);
-        for (auto r: regionNeighbors(e.region)) {
-             if (r != -1) {
-                 addInfluence(r, e.team, e.influence / 4);
-             }
+    // A single entity at full strength saturates its team color.  Only the
+    // strongest entity matters, so ordinary moves don't rescale the colors
+    // of the whole map.
+    heat_.clear();
+    heatScale_ = 1;
+    for (const auto &e : influence_.entities()) {
+        const auto p = pixelFromRegion(e.region);
+        heat_.addSource(e.team, p.x / heatCellSize, p.y / heatCellSize,
+                        e.influence);
+        if (e.team >= 0) {
+            heatScale_ = std::max(heatScale_, e.influence);
+        }
+    }
+    heat_.blur();
+
+    // Blend the team colors by influence, fading toward grey where nobody
+    // has much.
+    const int numTeams = heat_.numTeams();
+    const auto &colors = teamColors_;
+    for (int row = 0, i = 0; row < heat_.rows(); ++row) {
+        for (int col = 0; col < heat_.cols(); ++col, ++i) {
+            float total = 0.0f;
+            float r = 0.0f, g = 0.0f, b = 0.0f;
+            for (int t = 0; t < numTeams; ++t) {
+                const auto v = heat_.get(t, col, row);
+                total += v;
+                r += v * colors[t].r;
+                g += v * colors[t].g;
+                b += v * colors[t].b;
+            }
+            if (total <= 0.0f) {
+                heatColors_[i] = GREY;
+                continue;
+            }
+
+            const auto s = std::min(total / heatScale_, 1.0f);
+            heatColors_[i] = {
+                static_cast<Uint8>(GREY.r * (1 - s) + r / total * s),
+                static_cast<Uint8>(GREY.g * (1 - s) + g / total * s),
+                static_cast<Uint8>(GREY.b * (1 - s) + b / total * s),
+                SDL_ALPHA_OPAQUE
+            };
         }
     }
 }
 
-const MapEntity * SimpleMap::findEntity(int id) const
+SDL_Color SimpleMap::sampleHeat(int mapX, int mapY) const
 {
-    auto it = lower_bound(begin(entities_), end(entities_), id,
-        [] (const MapEntity &elem, int id) { return elem.id < id; });
-
-    if (it != end(entities_) && it->id == id) {
-        return &*it;
-    }
-
-    return nullptr;
+    // Bilinear interpolation between cell centers, in 8-bit fixed point.
+    const int cols = heat_.cols();
+    const int rows = heat_.rows();
+    const int u = std::max(mapX * 256 / heatCellSize - 128, 0);
+    const int v = std::max(mapY * 256 / heatCellSize - 128, 0);
+    const int c0 = std::min(u >> 8, cols - 1);
+    const int r0 = std::min(v >> 8, rows - 1);
+    const int c1 = std::min(c0 + 1, cols - 1);
+    const int r1 = std::min(r0 + 1, rows - 1);
+    const int fx = u & 255;
+    const int fy = v & 255;
+
+    const auto &p00 = heatColors_[r0 * cols + c0];
+    const auto &p10 = heatColors_[r0 * cols + c1];
+    const auto &p01 = heatColors_[r1 * cols + c0];
+    const auto &p11 = heatColors_[r1 * cols + c1];
+    auto mix = [fx, fy] (int a, int b, int c, int d) {
+        const int top = a * (256 - fx) + b * fx;
+        const int bottom = c * (256 - fx) + d * fx;
+        return static_cast<Uint8>((top * (256 - fy) + bottom * fy) >> 16);
+    };
+    return {mix(p00.r, p10.r, p01.r, p11.r),
+            mix(p00.g, p10.g, p01.g, p11.g),
+            mix(p00.b, p10.b, p01.b, p11.b),
+            SDL_ALPHA_OPAQUE};
 }
 
-MapEntity * SimpleMap::findEntity(int id)
+int SimpleMap::regionWidth() const
 {
-    return const_cast<MapEntity *>(const_cast<const SimpleMap &>(*this).findEntity(id));
+    if (shape_ == MapShape::HEX) {
+        return hexes_.hexWidth();
+    }
+    if (shape_ == MapShape::VORONOI && !cells_.empty()) {
+        return static_cast<int>(width_ / std::sqrt(cells_.size()));
+    }
+    return width_ / xRegions;
 }
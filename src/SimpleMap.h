@@ -13,62 +13,156 @@
 #ifndef SIMPLE_MAP_H
 #define SIMPLE_MAP_H
 
+#include "FrameArena.h"
+#include "Heatmap.h"
+#include "HexGrid.h"
+#include "InfluenceMap.h"
+#include "Visibility.h"
+#include "voronoi.h"
 #include "sdl_utils.h"
 #include "team_color.h"
 #include <vector>
 
-struct MapEntity
+// One level of the map image pyramid.  Level k is the full map scaled down by
+// 2^k, rounded up.  Each pixel records which region it belongs to, and for
+// pixels on a region boundary, which direction the neighboring region is in.
+// Voronoi maps leave the labels and borders empty.
+struct MapLevel
 {
-    int id;
-    int region;
-    int influence;
-    Team team;
+    int width;
+    int height;
+    std::vector<Uint16> labels;
+    std::vector<Uint8> borders;  // 0 if not a border, else direction + 1
+    std::vector<SDL_Rect> regionBounds;
 };
 
 
+// How regions are laid out on the map.  Voronoi maps store each region as a
+// polygon instead of labeling every pixel.
+enum class MapShape {GRID, HEX, VORONOI};
+
+// Ways of drawing the inside of each region.  Borders always show who owns
+// the regions on either side.
+enum class MapStyle {FLAT, HEATMAP};
+
+
+// Draws an InfluenceMap whose regions are laid out as a rectangular grid or
+// as hexes.  Region labels are computed once per pyramid level, so the shape
+// doesn't affect how fast tiles are drawn.
 class SimpleMap
 {
 public:
-    SimpleMap(int width, int height, int numTeams,
-              const SdlSurface &blankUpdateSurf);
-
-    SdlSurface update();
+    // The thread pool, if any, is used to compute the heatmap.  The seed
+    // decides where Voronoi regions go; other shapes ignore it.
+    SimpleMap(int width, int height, MapShape shape, int numTeams,
+              int numLevels = 4, ThreadPool *pool = nullptr,
+              unsigned int seed = 1);
+
+    int width(int level = 0) const;
+    int height(int level = 0) const;
+    int numLevels() const;
+    MapShape shape() const;
+    unsigned int seed() const;
+
+    const InfluenceMap & influence() const;
+
+    // Draw the map as seen by one team, hiding regions it can't see under
+    // fog.  Team -1 sees everything.  Changing the viewer changes the whole
+    // map, so redraw it afterward.
+    void setViewer(int team);
+    int viewer() const;
+    bool isVisible(int region) const;
+
+    // Regions are flat grey by default.  The heatmap blends team colors by
+    // how much influence each team has at every pixel.  Changing the style
+    // changes the whole map, so redraw it afterward.
+    void setStyle(MapStyle style);
+    MapStyle style() const;
+
+    // Recompute each team's influence after entities have moved.
+    void update();
+
+    // Areas of a pyramid level whose colors changed during the last update,
+    // either because the owner changed or the region came in or out of view.
+    // Replaces the contents of 'rects', reusing its memory.
+    void dirtyRects(int level, std::vector<SDL_Rect> &rects) const;
+
+    // Draw the part of pyramid level 'level' covered by 'levelRect' into the
+    // upper-left corner of 'dest'.
+    void drawTile(int level, const SDL_Rect &levelRect, SdlSurface &dest) const;
 
     void addEntity(MapEntity entity);
     void moveEntity(int id, int toReg);
     int getRegion(int entityId) const;
 
+    // Put every entity back where a saved state had it, without recomputing
+    // influence.  The whole map changes, so redraw it afterward.  Returns
+    // false if the state came from a different map.
+    bool restore(InfluenceState state);
+
     // Return the center pixel of the given region.
     SDL_Point pixelFromRegion(int reg) const;
 
+    // Region under a map pixel, or -1 if it's off the map.  Reads the label
+    // buffer, so it works for any region shape.
+    int regionAt(const SDL_Point &p) const;
+
 private:
-    SDL_Point pixelFromAry(int a) const;
     int regionFromPixel(const SDL_Point &p) const;
-    int regionFromAry(int a) const;
 
-    SDL_Color getColor(int a) const;
-    SDL_Color getBorderColor(int reg1, int reg2) const;
+    RegionGraph makeGraph() const;
+
+    // Label each pixel of a pyramid level by sampling the full-size map at the
+    // center of the area it covers.
+    MapLevel buildLevel(int level) const;
+    MapLevel buildPolygonLevel(int level) const;
+
+    // Fill a tile of a Voronoi map one cell at a time, a row of pixels at a
+    // time.
+    void drawCells(int level, const SDL_Rect &levelRect,
+                   SdlSurface &dest) const;
 
-    // Return the team number with the most influence in a region, or -1 if all
-    // teams have the same influence.
-    int getOwner(int region) const;
+    SDL_Color getColor(const MapLevel &level, int a) const;
+
+    // Like getColor, but region interiors come from the heatmap sampled at
+    // map pixel (mapX,mapY).
+    SDL_Color getHeatColor(const MapLevel &level, int a,
+                           int mapX, int mapY) const;
+
+    // Rebuild the heatmap from where every entity is now.
+    void updateHeat();
+    SDL_Color sampleHeat(int mapX, int mapY) const;
+    SDL_Color getBorderColor(int reg1, int reg2) const;
 
-    // Return the index of the team's data in the influence map.
-    int teamOffset(int region, Team team) const;
+    // Neighboring Voronoi cell closest to a border pixel of 'region'.
+    int nearestNeighbor(int region, int mapX, int mapY) const;
 
-    // Spread each entity's influence to neighboring regions.
-    void addInfluence(int region, Team team, int value);
-    void relaxInfluence();
+    // Owner of a region as far as the viewer knows.
+    int visibleOwner(int region) const;
 
-    const MapEntity * findEntity(int id) const;
-    MapEntity * findEntity(int id);
+    // Approximate width of one region in map pixels.
+    int regionWidth() const;
 
     int width_;
     int height_;
-    int numTeams_;
-    std::vector<int> influence_;
-    std::vector<MapEntity> entities_;
-    SdlSurface updateSurf_;
+    MapShape shape_;
+    unsigned int seed_;
+    HexGrid hexes_;  // empty unless shape_ is HEX
+    std::vector<VoronoiCell> cells_;  // empty unless shape_ is VORONOI
+    InfluenceMap influence_;
+    Visibility visibility_;
+    int viewer_;
+    std::vector<int> dirtyRegions_;
+    std::vector<MapLevel> levels_;
+    MapStyle style_;
+    Heatmap heat_;
+    std::vector<SDL_Color> heatColors_;  // one per heatmap cell
+    std::vector<SDL_Color> teamColors_;
+    int heatScale_;  // influence at which a cell shows full team color
+    std::vector<int> movedRegions_;  // where entities moved from and to
+    std::vector<SDL_Rect> heatDirty_;  // in map pixels
+    bool isHeatAllDirty_;
+    mutable FrameArena scratch_;  // temporaries while drawing a tile
 };
 
 #endif
@@ -0,0 +1,125 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "SpatialGrid.h"
+#include <algorithm>
+
+namespace
+{
+    const std::vector<int> empty;
+
+    // Room in each bucket up front, so objects moving into cells nobody has
+    // visited yet don't allocate.
+    const int bucketReserve = 4;
+}
+
+SpatialGrid::SpatialGrid()
+    : cols_{0},
+    rows_{0},
+    cellSize_{1},
+    cells_{}
+{
+}
+
+SpatialGrid::SpatialGrid(int width, int height, int cellSize)
+    : cols_{(width + cellSize - 1) / cellSize},
+    rows_{(height + cellSize - 1) / cellSize},
+    cellSize_{cellSize},
+    cells_(cols_ * rows_)
+{
+    for (auto &bucket : cells_) {
+        bucket.reserve(bucketReserve);
+    }
+}
+
+void SpatialGrid::insert(int id, const SDL_Rect &bounds)
+{
+    SDL_Rect cells;
+    if (!cellRange(bounds, cells)) {
+        return;
+    }
+
+    for (int y = cells.y; y < cells.y + cells.h; ++y) {
+        for (int x = cells.x; x < cells.x + cells.w; ++x) {
+            cells_[y * cols_ + x].push_back(id);
+        }
+    }
+}
+
+void SpatialGrid::remove(int id, const SDL_Rect &bounds)
+{
+    SDL_Rect cells;
+    if (!cellRange(bounds, cells)) {
+        return;
+    }
+
+    for (int y = cells.y; y < cells.y + cells.h; ++y) {
+        for (int x = cells.x; x < cells.x + cells.w; ++x) {
+            auto &bucket = cells_[y * cols_ + x];
+            auto iter = find(begin(bucket), end(bucket), id);
+            if (iter != end(bucket)) {
+                *iter = bucket.back();
+                bucket.pop_back();
+            }
+        }
+    }
+}
+
+void SpatialGrid::move(int id, const SDL_Rect &oldBounds,
+                       const SDL_Rect &newBounds)
+{
+    SDL_Rect oldCells = {0, 0, 0, 0};
+    SDL_Rect newCells = {0, 0, 0, 0};
+    const bool hadCells = cellRange(oldBounds, oldCells);
+    const bool hasCells = cellRange(newBounds, newCells);
+    if (hadCells == hasCells &&
+        oldCells.x == newCells.x && oldCells.y == newCells.y &&
+        oldCells.w == newCells.w && oldCells.h == newCells.h)
+    {
+        return;  // still in the same buckets
+    }
+
+    remove(id, oldBounds);
+    insert(id, newBounds);
+}
+
+const std::vector<int> & SpatialGrid::candidates(const SDL_Point &p) const
+{
+    if (p.x < 0 || p.y < 0) {
+        return empty;
+    }
+
+    const int x = p.x / cellSize_;
+    const int y = p.y / cellSize_;
+    if (x >= cols_ || y >= rows_) {
+        return empty;
+    }
+    return cells_[y * cols_ + x];
+}
+
+bool SpatialGrid::cellRange(const SDL_Rect &r, SDL_Rect &cells) const
+{
+    if (r.w <= 0 || r.h <= 0 || r.x + r.w <= 0 || r.y + r.h <= 0) {
+        return false;
+    }
+
+    const int x1 = std::max(r.x, 0) / cellSize_;
+    const int y1 = std::max(r.y, 0) / cellSize_;
+    const int x2 = std::min((r.x + r.w - 1) / cellSize_, cols_ - 1);
+    const int y2 = std::min((r.y + r.h - 1) / cellSize_, rows_ - 1);
+    if (x1 > x2 || y1 > y2) {
+        return false;
+    }
+
+    cells = {x1, y1, x2 - x1 + 1, y2 - y1 + 1};
+    return true;
+}
@@ -0,0 +1,48 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include "sdl_utils.h"
+#include <vector>
+
+// Buckets of object ids by which fixed-size square cells their bounding
+// boxes overlap, for finding what's under a point without checking every
+// object.  Objects that move only change buckets when they cross into a
+// different range of cells.
+class SpatialGrid
+{
+public:
+    SpatialGrid();
+    SpatialGrid(int width, int height, int cellSize);
+
+    void insert(int id, const SDL_Rect &bounds);
+    void remove(int id, const SDL_Rect &bounds);
+    void move(int id, const SDL_Rect &oldBounds, const SDL_Rect &newBounds);
+
+    // Every object whose bounds might contain the point.  The caller still
+    // has to check each one.
+    const std::vector<int> & candidates(const SDL_Point &p) const;
+
+private:
+    // Range of cells covered by a rectangle, clipped to the grid.  Returns
+    // false if it doesn't touch the grid at all.
+    bool cellRange(const SDL_Rect &r, SDL_Rect &cells) const;
+
+    int cols_;
+    int rows_;
+    int cellSize_;
+    std::vector<std::vector<int>> cells_;
+};
+
+#endif
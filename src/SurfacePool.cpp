@@ -0,0 +1,69 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "SurfacePool.h"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+namespace
+{
+    bool isIdle(const SdlSurface &surf)
+    {
+        return surf.use_count() == 1;
+    }
+}
+
+SurfacePool::SurfacePool()
+    : surfaces_{}
+{
+}
+
+SdlSurface SurfacePool::acquire(int width, int height,
+                                const SDL_PixelFormat *format)
+{
+    assert(format);
+    for (const auto &surf : surfaces_) {
+        if (isIdle(surf) && surf->w == width && surf->h == height &&
+            surf->format->format == format->format)
+        {
+            return surf;
+        }
+    }
+
+    auto surf = SDL_CreateRGBSurface(0,
+                                     width,
+                                     height,
+                                     format->BitsPerPixel,
+                                     format->Rmask,
+                                     format->Gmask,
+                                     format->Bmask,
+                                     format->Amask);
+    if (!surf) {
+        std::cerr << "Error creating pooled surface: " << SDL_GetError();
+        return {};
+    }
+
+    surfaces_.push_back(make_surface(surf));
+    return surfaces_.back();
+}
+
+void SurfacePool::trim()
+{
+    surfaces_.erase(remove_if(begin(surfaces_), end(surfaces_), isIdle),
+                    end(surfaces_));
+}
+
+int SurfacePool::size() const
+{
+    return surfaces_.size();
+}
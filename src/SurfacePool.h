@@ -0,0 +1,42 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef SURFACE_POOL_H
+#define SURFACE_POOL_H
+
+#include "sdl_utils.h"
+#include <vector>
+
+// Surfaces that are recycled instead of freed.  The pool holds on to every
+// surface it hands out, and once nobody else does, the surface can be handed
+// out again.  Reusing one only copies a shared pointer, so after the pool
+// has grown to its working size, acquiring a surface allocates nothing.
+class SurfacePool
+{
+public:
+    SurfacePool();
+
+    // Return an unused surface of the given size with the same pixel format
+    // as 'format', creating one if necessary.  Contents are left over from
+    // whoever used it last.  Returns null on failure.
+    SdlSurface acquire(int width, int height, const SDL_PixelFormat *format);
+
+    // Free every surface nobody else is using.
+    void trim();
+
+    int size() const;
+
+private:
+    std::vector<SdlSurface> surfaces_;
+};
+
+#endif
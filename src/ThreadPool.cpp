@@ -0,0 +1,163 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace
+{
+    // Enough for a few parallelFor calls in flight without growing.
+    const int initialQueueSize = 64;
+}
+
+ThreadPool::ThreadPool(int numThreads)
+    : workers_{},
+    threads_{},
+    sleepMutex_{},
+    hasWork_{},
+    allDone_{},
+    pending_{0},
+    nextQueue_{0},
+    isStopping_{false}
+{
+    if (numThreads <= 0) {
+        numThreads = std::max<int>(boost::thread::hardware_concurrency(), 1);
+    }
+
+    for (int i = 0; i < numThreads; ++i) {
+        workers_.emplace_back(new Worker);
+        workers_.back()->tasks.reserve(initialQueueSize);
+        workers_.back()->head = 0;
+    }
+    for (int i = 0; i < numThreads; ++i) {
+        threads_.create_thread([this, i] { run(i); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        boost::lock_guard<boost::mutex> lock(sleepMutex_);
+        isStopping_ = true;
+    }
+    hasWork_.notify_all();
+    threads_.join_all();
+}
+
+int ThreadPool::size() const
+{
+    return workers_.size();
+}
+
+void ThreadPool::submit(std::function<void ()> task)
+{
+    ++pending_;
+    const auto index = nextQueue_++ % workers_.size();
+    {
+        auto &worker = *workers_[index];
+        boost::lock_guard<boost::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+
+    // Take the sleep lock so a worker can't miss the wakeup between checking
+    // the queues and going to sleep.
+    boost::lock_guard<boost::mutex> lock(sleepMutex_);
+    hasWork_.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    boost::unique_lock<boost::mutex> lock(sleepMutex_);
+    while (pending_ > 0) {
+        allDone_.wait(lock);
+    }
+}
+
+void ThreadPool::parallelFor(int n, const std::function<void (int)> &fn)
+{
+    // A few chunks per thread balances the load without a task per index.
+    const int numChunks = std::min(n, size() * 4);
+    for (int c = 0; c < numChunks; ++c) {
+        const int first = static_cast<long long>(n) * c / numChunks;
+        const int last = static_cast<long long>(n) * (c + 1) / numChunks;
+        submit([&fn, first, last] {
+            for (int i = first; i < last; ++i) {
+                fn(i);
+            }
+        });
+    }
+    wait();
+}
+
+void ThreadPool::run(int index)
+{
+    std::function<void ()> task;
+    for (;;) {
+        if (!popTask(index, task)) {
+            boost::unique_lock<boost::mutex> lock(sleepMutex_);
+            if (isStopping_) {
+                return;
+            }
+
+            // Tasks may have arrived since we looked.  Check again while
+            // holding the lock submit() needs in order to wake us.
+            if (!popTask(index, task)) {
+                hasWork_.wait(lock);
+                continue;
+            }
+        }
+
+        task();
+        task = nullptr;
+        if (--pending_ == 0) {
+            boost::lock_guard<boost::mutex> lock(sleepMutex_);
+            allDone_.notify_all();
+        }
+    }
+}
+
+bool ThreadPool::popTask(int index, std::function<void ()> &task)
+{
+    // Own queue first, oldest task first.
+    {
+        auto &own = *workers_[index];
+        boost::lock_guard<boost::mutex> lock(own.mutex);
+        if (own.head < own.tasks.size()) {
+            task = std::move(own.tasks[own.head]);
+            ++own.head;
+            if (own.head == own.tasks.size()) {
+                own.tasks.clear();
+                own.head = 0;
+            }
+            return true;
+        }
+    }
+
+    // Steal the newest task from someone else, to stay away from the end
+    // the owner is working on.
+    const int n = size();
+    for (int i = 1; i < n; ++i) {
+        auto &victim = *workers_[(index + i) % n];
+        boost::lock_guard<boost::mutex> lock(victim.mutex);
+        if (victim.head < victim.tasks.size()) {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            if (victim.head == victim.tasks.size()) {
+                victim.tasks.clear();
+                victim.head = 0;
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
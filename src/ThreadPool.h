@@ -0,0 +1,73 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include "boost/thread.hpp"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Fixed set of worker threads, each with its own task queue.  A worker that
+// runs out of work steals from the other queues before going to sleep, so
+// uneven tasks still keep every core busy.
+class ThreadPool
+{
+public:
+    // Use one thread per core if 'numThreads' is 0.
+    explicit ThreadPool(int numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool & operator=(const ThreadPool &) = delete;
+
+    int size() const;
+
+    void submit(std::function<void ()> task);
+
+    // Block until every task submitted so far has finished.  Don't call this
+    // from inside a task, it would wait on itself.
+    void wait();
+
+    // Call fn(i) for every i in [0, n) across the pool and wait for them all.
+    // Indexes are handed out in chunks to keep queue traffic down.  Same
+    // restriction as wait().
+    void parallelFor(int n, const std::function<void (int)> &fn);
+
+private:
+    // Tasks before 'head' have been taken.  The queue is emptied once they
+    // all are, so it keeps its memory instead of allocating as it cycles.
+    struct Worker
+    {
+        boost::mutex mutex;
+        std::vector<std::function<void ()>> tasks;
+        std::size_t head;
+    };
+
+    void run(int index);
+
+    // Take a task from our own queue, or failing that, someone else's.
+    bool popTask(int index, std::function<void ()> &task);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    boost::thread_group threads_;
+    boost::mutex sleepMutex_;
+    boost::condition_variable hasWork_;
+    boost::condition_variable allDone_;
+    std::atomic<int> pending_;
+    std::atomic<unsigned> nextQueue_;
+    bool isStopping_;
+};
+
+#endif
@@ -0,0 +1,207 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "TileCache.h"
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+    // Key of a texture that isn't holding any tile yet.  No real tile has
+    // it, since there are never 255 levels.
+    const Uint64 unusedKey = ~0ULL;
+
+    // Tile coordinates are never negative and a map would have to be
+    // millions of pixels across to need more than 28 bits for them.
+    Uint64 tileKey(int level, int tx, int ty)
+    {
+        return (static_cast<Uint64>(level) << 56) |
+            (static_cast<Uint64>(tx) << 28) |
+            static_cast<Uint64>(ty);
+    }
+}
+
+TileCache::TileCache(SdlWindow &win, int tileSize, int capacity)
+    : win_(win),
+    tileSize_{tileSize},
+    capacity_{capacity},
+    mapWidth_{0},
+    mapHeight_{0},
+    numLevels_{1},
+    renderer_{},
+    scratch_{win.createBlankSurface(tileSize, tileSize)},
+    tiles_{},
+    index_{},
+    generation_{0},
+    frame_{0}
+{
+    // Create every texture up front, so the cache never allocates as it
+    // fills up, only when a frame needs more tiles than it can hold.
+    index_.reserve(capacity + 1);
+    for (int i = 0; i < capacity_; ++i) {
+        SdlTextureStream tex{scratch_, win_};
+        if (!tex) {
+            break;
+        }
+        tiles_.push_back(Tile{unusedKey, 0, 0, 0, std::move(tex), 0, 0});
+    }
+}
+
+void TileCache::setMap(int width, int height, int numLevels,
+                       TileRenderer fn)
+{
+    assert(numLevels > 0);
+    mapWidth_ = width;
+    mapHeight_ = height;
+    numLevels_ = numLevels;
+    renderer_ = std::move(fn);
+    invalidate();
+}
+
+int TileCache::tileSize() const
+{
+    return tileSize_;
+}
+
+int TileCache::numLevels() const
+{
+    return numLevels_;
+}
+
+int TileCache::levelWidth(int level) const
+{
+    const int scale = 1 << level;
+    return (mapWidth_ + scale - 1) / scale;
+}
+
+int TileCache::levelHeight(int level) const
+{
+    const int scale = 1 << level;
+    return (mapHeight_ + scale - 1) / scale;
+}
+
+void TileCache::beginFrame()
+{
+    ++frame_;
+
+    // Give back anything we had to allocate beyond capacity last frame.
+    while (static_cast<int>(tiles_.size()) > capacity_) {
+        eraseIndex(tiles_.back().key);
+        tiles_.pop_back();
+    }
+}
+
+void TileCache::draw(int level, int tx, int ty, const SDL_Rect &dest)
+{
+    assert(renderer_);
+    assert(level >= 0 && level < numLevels_);
+    const auto key = tileKey(level, tx, ty);
+    const auto levelRect = tileRect(level, tx, ty);
+    if (levelRect.w <= 0 || levelRect.h <= 0) {
+        return;
+    }
+
+    TileList::iterator tile;
+    auto iter = findIndex(key);
+    if (iter != std::end(index_) && iter->first == key) {
+        tile = iter->second;
+        tiles_.splice(std::begin(tiles_), tiles_, tile);
+    }
+    else {
+        tile = acquire(level, tx, ty);
+        if (tile == std::end(tiles_)) {
+            return;
+        }
+    }
+
+    if (tile->generation != generation_) {
+        renderer_(level, levelRect, scratch_);
+        tile->tex.update(scratch_);
+        tile->generation = generation_;
+    }
+    tile->lastFrame = frame_;
+
+    const SDL_Rect src = {0, 0, levelRect.w, levelRect.h};
+    tile->tex.drawZoomed(dest, &src);
+}
+
+void TileCache::invalidate()
+{
+    ++generation_;
+}
+
+void TileCache::invalidate(int level, const SDL_Rect &levelRect)
+{
+    for (auto &tile : tiles_) {
+        if (tile.level != level) {
+            continue;
+        }
+
+        const auto rect = tileRect(tile.level, tile.tx, tile.ty);
+        if (SDL_HasIntersection(&rect, &levelRect)) {
+            tile.generation = generation_ - 1;
+        }
+    }
+}
+
+SDL_Rect TileCache::tileRect(int level, int tx, int ty) const
+{
+    const int x = tx * tileSize_;
+    const int y = ty * tileSize_;
+    return {x,
+            y,
+            std::min(tileSize_, levelWidth(level) - x),
+            std::min(tileSize_, levelHeight(level) - y)};
+}
+
+TileCache::TileList::iterator TileCache::acquire(int level, int tx, int ty)
+{
+    const auto key = tileKey(level, tx, ty);
+    if (static_cast<int>(tiles_.size()) >= capacity_ &&
+        tiles_.back().lastFrame != frame_)
+    {
+        // Recycle the least recently used texture.
+        auto oldest = std::prev(std::end(tiles_));
+        eraseIndex(oldest->key);
+        tiles_.splice(std::begin(tiles_), tiles_, oldest);
+    }
+    else {
+        SdlTextureStream tex{scratch_, win_};
+        if (!tex) {
+            return std::end(tiles_);
+        }
+        tiles_.push_front(Tile{0, 0, 0, 0, std::move(tex), 0, 0});
+    }
+
+    auto tile = std::begin(tiles_);
+    tile->key = key;
+    tile->level = level;
+    tile->tx = tx;
+    tile->ty = ty;
+    tile->generation = generation_ - 1;  // force a redraw
+    index_.insert(findIndex(key), IndexEntry{key, tile});
+    return tile;
+}
+
+std::vector<TileCache::IndexEntry>::iterator TileCache::findIndex(Uint64 key)
+{
+    return lower_bound(std::begin(index_), std::end(index_), key,
+        [] (const IndexEntry &entry, Uint64 key) { return entry.first < key; });
+}
+
+void TileCache::eraseIndex(Uint64 key)
+{
+    auto iter = findIndex(key);
+    if (iter != std::end(index_) && iter->first == key) {
+        index_.erase(iter);
+    }
+}
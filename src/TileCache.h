@@ -0,0 +1,99 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef TILE_CACHE_H
+#define TILE_CACHE_H
+
+#include "SdlTextureStream.h"
+#include "SdlWindow.h"
+#include "sdl_utils.h"
+#include <functional>
+#include <list>
+#include <utility>
+#include <vector>
+
+// Textures for fixed-size square pieces of a map too large to draw all at
+// once.  Tiles are rasterized only when they're drawn, and the least recently
+// used ones are recycled when the cache is full.  The map can have several
+// levels of detail, where level k is the map scaled down by 2^k.
+class TileCache
+{
+public:
+    // Draw the part of a map level covered by 'levelRect' into the upper-left
+    // corner of 'dest'.
+    using TileRenderer = std::function<void (int level,
+                                             const SDL_Rect &levelRect,
+                                             SdlSurface &dest)>;
+
+    TileCache(SdlWindow &win, int tileSize, int capacity);
+
+    void setMap(int width, int height, int numLevels, TileRenderer fn);
+    int tileSize() const;
+
+    // Tiles drawn during the current frame are never evicted to make room for
+    // other tiles in the same frame, even if that means going over capacity.
+    void beginFrame();
+
+    int numLevels() const;
+    int levelWidth(int level) const;
+    int levelHeight(int level) const;
+
+    // Draw tile (tx,ty) of the given level scaled to fit the destination
+    // rectangle.
+    void draw(int level, int tx, int ty, const SDL_Rect &dest);
+
+    // Mark every cached tile as needing to be rasterized again.
+    void invalidate();
+
+    // Mark the cached tiles of one level that overlap 'levelRect'.
+    void invalidate(int level, const SDL_Rect &levelRect);
+
+private:
+    struct Tile
+    {
+        Uint64 key;
+        int level;
+        int tx;
+        int ty;
+        SdlTextureStream tex;
+        Uint32 generation;
+        Uint32 lastFrame;
+    };
+    using TileList = std::list<Tile>;
+    using IndexEntry = std::pair<Uint64, TileList::iterator>;
+
+    // Return the area of a map level covered by a tile, clipped to the edges.
+    SDL_Rect tileRect(int level, int tx, int ty) const;
+
+    // Find a texture to hold a new tile, recycling the oldest one if we can.
+    TileList::iterator acquire(int level, int tx, int ty);
+
+    // Position of a key in the index, or where it would be inserted.
+    std::vector<IndexEntry>::iterator findIndex(Uint64 key);
+    void eraseIndex(Uint64 key);
+
+    SdlWindow &win_;
+    int tileSize_;
+    int capacity_;
+    int mapWidth_;
+    int mapHeight_;
+    int numLevels_;
+    TileRenderer renderer_;
+    SdlSurface scratch_;
+    TileList tiles_;  // most recently used first
+    // Sorted by key.  Unlike a hash map, recycling a tile doesn't allocate.
+    std::vector<IndexEntry> index_;
+    Uint32 generation_;
+    Uint32 frame_;
+};
+
+#endif
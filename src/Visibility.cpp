@@ -0,0 +1,120 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "Visibility.h"
+#include <algorithm>
+#include <cassert>
+
+Visibility::Visibility(const RegionGraph &graph, int numTeams,
+                       int sightRadius)
+    : graph_(graph),
+    numTeams_{numTeams},
+    sightRadius_{sightRadius},
+    counts_(graph.size() * numTeams, 0),
+    changed_(numTeams),
+    isChanged_(graph.size() * numTeams, 0),
+    queue_{},
+    dist_(graph.size(), -1)
+{
+    assert(sightRadius >= 0);
+}
+
+void Visibility::addEntity(const MapEntity &entity)
+{
+    const auto team = entity.team;
+    if (team >= 0 && team < numTeams_) {
+        updateSight(team, entity.region, 1);
+    }
+}
+
+void Visibility::moveEntity(const MapEntity &entity, int toReg)
+{
+    const auto team = entity.team;
+    if (team < 0 || team >= numTeams_ || entity.region == toReg) {
+        return;
+    }
+
+    // Add the new sight first so regions seen from both places never drop
+    // to zero and get reported as changed.
+    updateSight(team, toReg, 1);
+    updateSight(team, entity.region, -1);
+}
+
+void Visibility::clear()
+{
+    fill(begin(counts_), end(counts_), 0);
+    clearChanges();
+}
+
+bool Visibility::isVisible(int team, int region) const
+{
+    assert(team >= 0 && team < numTeams_);
+    assert(region >= 0 && region < graph_.size());
+    return counts_[team * graph_.size() + region] > 0;
+}
+
+const std::vector<int> & Visibility::changedRegions(int team) const
+{
+    assert(team >= 0 && team < numTeams_);
+    return changed_[team];
+}
+
+void Visibility::clearChanges()
+{
+    for (int t = 0; t < numTeams_; ++t) {
+        for (auto r : changed_[t]) {
+            isChanged_[t * graph_.size() + r] = 0;
+        }
+        changed_[t].clear();
+    }
+}
+
+void Visibility::updateSight(int team, int region, int delta)
+{
+    auto *counts = &counts_[team * graph_.size()];
+    queue_.assign(1, region);
+    dist_[region] = 0;
+
+    for (std::size_t i = 0; i < queue_.size(); ++i) {
+        const auto reg = queue_[i];
+        const auto before = counts[reg];
+        counts[reg] += delta;
+        assert(counts[reg] >= 0);
+        if ((before == 0) != (counts[reg] == 0)) {
+            markChanged(team, reg);
+        }
+
+        if (dist_[reg] == sightRadius_) {
+            continue;
+        }
+        for (auto nbr : graph_.neighbors(reg)) {
+            if (dist_[nbr] < 0) {
+                dist_[nbr] = dist_[reg] + 1;
+                queue_.push_back(nbr);
+            }
+        }
+    }
+
+    // Only the regions we visited need resetting.
+    for (auto reg : queue_) {
+        dist_[reg] = -1;
+    }
+}
+
+void Visibility::markChanged(int team, int region)
+{
+    auto &flag = isChanged_[team * graph_.size() + region];
+    if (!flag) {
+        flag = 1;
+        changed_[team].push_back(region);
+    }
+}
@@ -0,0 +1,61 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef VISIBILITY_H
+#define VISIBILITY_H
+
+#include "InfluenceState.h"
+#include "RegionGraph.h"
+#include <vector>
+
+// Which regions each team can see.  A region is visible to a team while at
+// least one of its entities is within sight range.  We keep a count of how
+// many entities see each region, so a move only touches the regions around
+// where the entity left and where it arrived.
+class Visibility
+{
+public:
+    Visibility(const RegionGraph &graph, int numTeams, int sightRadius);
+
+    // Entities that belong to nobody don't see anything.
+    void addEntity(const MapEntity &entity);
+    void moveEntity(const MapEntity &entity, int toReg);
+
+    // Forget every entity, as if the map were empty.
+    void clear();
+
+    bool isVisible(int team, int region) const;
+
+    // Regions that became visible or hidden to a team since the last call to
+    // clearChanges().
+    const std::vector<int> & changedRegions(int team) const;
+    void clearChanges();
+
+private:
+    // Add 'delta' to the count of every region within sight of 'region'.
+    void updateSight(int team, int region, int delta);
+
+    void markChanged(int team, int region);
+
+    const RegionGraph &graph_;
+    int numTeams_;
+    int sightRadius_;
+    std::vector<int> counts_;  // numRegions entries per team
+    std::vector<std::vector<int>> changed_;
+    std::vector<char> isChanged_;  // same layout as counts_
+
+    // Scratch space for the breadth-first search, reused between moves.
+    std::vector<int> queue_;
+    std::vector<int> dist_;
+};
+
+#endif
@@ -0,0 +1,96 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "alloc_counter.h"
+
+#ifdef COUNT_ALLOCS
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    std::atomic<long long> numAllocs(0);
+
+    // thread_local needs a newer compiler than we build with.
+    __thread bool isIgnored = false;
+
+    void count()
+    {
+        if (!isIgnored) {
+            ++numAllocs;
+        }
+    }
+
+    void * countedAlloc(std::size_t size)
+    {
+        count();
+        if (auto p = std::malloc(size ? size : 1)) {
+            return p;
+        }
+        throw std::bad_alloc();
+    }
+}
+
+// The array and nothrow forms default to calling these in a conforming
+// library, but replace them all so nothing slips past.
+void * operator new(std::size_t size)
+{
+    return countedAlloc(size);
+}
+
+void * operator new[](std::size_t size)
+{
+    return countedAlloc(size);
+}
+
+void * operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    count();
+    return std::malloc(size ? size : 1);
+}
+
+void * operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    count();
+    return std::malloc(size ? size : 1);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+long long allocCount()
+{
+    return numAllocs;
+}
+
+void ignoreAllocsOnThisThread()
+{
+    isIgnored = true;
+}
+#else
+long long allocCount()
+{
+    return 0;
+}
+
+void ignoreAllocsOnThisThread()
+{
+}
+#endif
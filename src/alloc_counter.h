@@ -0,0 +1,51 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <cassert>
+
+// Build with -DCOUNT_ALLOCS to count every call to the global operator new,
+// from any thread.  Without it, the count is always zero and the guard below
+// does nothing.  Allocations made by C libraries (SDL included) with malloc
+// aren't seen.
+long long allocCount();
+
+// Leave the calling thread's allocations out of the count, for background
+// work that runs alongside the code being checked.
+void ignoreAllocsOnThisThread();
+
+// Assert that nothing was allocated between construction and destruction.
+// Wrap code that is expected to reuse memory it already has.  Pass false to
+// skip the check, such as while a loop is still warming up.
+class NoAllocGuard
+{
+public:
+    explicit NoAllocGuard(bool isEnabled = true)
+        : start_{isEnabled ? allocCount() : -1}
+    {
+    }
+
+    ~NoAllocGuard()
+    {
+        assert(start_ < 0 || allocCount() == start_);
+    }
+
+    NoAllocGuard(const NoAllocGuard &) = delete;
+    NoAllocGuard & operator=(const NoAllocGuard &) = delete;
+
+private:
+    long long start_;
+};
+
+#endif
@@ -0,0 +1,445 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+// Nothing here needs SDL to be initialized, so keep SDL from taking over
+// main() and the bench from needing SDL2main to link.
+#define SDL_MAIN_HANDLED
+
+#include "InfluenceMap.h"
+#include "SimpleMap.h"
+#include "sdl_utils.h"
+#include "team_color.h"
+#include "rapidjson/document.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Microbenchmarks for the per-pixel and per-entity kernels.  Inputs come from
+// a fixed seed so runs are comparable.  Nothing here opens a window, so it
+// runs without a display.
+//
+// Usage: bench [--save FILE] [--baseline FILE]
+//
+// --save writes the results as a JSON object of name: ns per unit.
+// --baseline compares against a file written earlier by --save.
+
+namespace
+{
+    const unsigned int benchSeed = 1;
+    const int numTrials = 5;
+
+    // Run each trial at least this long, however big one call is.
+    const std::chrono::milliseconds minTrialTime{100};
+
+    // Results feed into this so the compiler can't throw the work away.
+    volatile unsigned int sink = 0;
+
+    struct BenchResult
+    {
+        std::string name;
+        double ns;  // per unit
+        const char *unit;
+    };
+
+    std::vector<BenchResult> results;
+
+    // Uniform ints in [lo, hi] scaled straight from the engine, like the map
+    // generator does.  std::uniform_int_distribution is free to change its
+    // algorithm between library versions, which would change the inputs.
+    class RandRange
+    {
+    public:
+        RandRange(int lo, int hi)
+            : lo_{lo},
+            span_(static_cast<unsigned long long>(hi - lo) + 1)
+        {
+        }
+
+        int operator()(std::minstd_rand &gen) const
+        {
+            const auto range = static_cast<unsigned long long>(
+                std::minstd_rand::max() - std::minstd_rand::min()) + 1;
+            const unsigned long long r = gen() - std::minstd_rand::min();
+            return lo_ + static_cast<int>(r * span_ / range);
+        }
+
+    private:
+        int lo_;
+        unsigned long long span_;
+    };
+
+    // Time 'calls' calls to 'fn', in nanoseconds.
+    double timeCalls(long long calls, const std::function<void()> &fn)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (long long c = 0; c < calls; ++c) {
+            fn();
+        }
+        const auto stop = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            stop - start).count();
+    }
+
+    // Time 'fn' over several trials and record the best time per unit.  The
+    // number of calls per trial doubles until a trial takes long enough, so
+    // slow kernels don't run for minutes and fast ones aren't lost in timer
+    // noise.  Those first runs also warm up caches and lazy initialization.
+    void run(const std::string &name, const char *unit, long long unitsPerCall,
+             const std::function<void()> &fn)
+    {
+        const double minNs =
+            std::chrono::nanoseconds(minTrialTime).count();
+        long long calls = 1;
+        while (timeCalls(calls, fn) < minNs) {
+            calls *= 2;
+        }
+
+        auto best = std::numeric_limits<double>::max();
+        for (int t = 0; t < numTrials; ++t) {
+            best = std::min(best,
+                            timeCalls(calls, fn) / (calls * unitsPerCall));
+        }
+        results.push_back(BenchResult{name, best, unit});
+    }
+
+    std::string sizeName(int size)
+    {
+        std::ostringstream str;
+        str << size << 'x' << size;
+        return str.str();
+    }
+
+    // 32-bit surface filled with random colors, about half of them from the
+    // magenta team color palette.
+    SdlSurface makeTestSurface(int size, std::minstd_rand &gen)
+    {
+        const SDL_Color magenta[] = {
+            {0x3F, 0, 0x16, SDL_ALPHA_OPAQUE},
+            {0x9E, 0, 0x5D, SDL_ALPHA_OPAQUE},
+            {0xEC, 0, 0x8C, SDL_ALPHA_OPAQUE},
+            {0xF4, 0x9A, 0xC1, SDL_ALPHA_OPAQUE}
+        };
+
+        auto surf = make_surface(SDL_CreateRGBSurface(0, size, size, 32,
+                                                      0x00ff0000,
+                                                      0x0000ff00,
+                                                      0x000000ff,
+                                                      0xff000000));
+        if (!surf) {
+            std::cerr << "Error creating surface: " << SDL_GetError();
+            throw std::runtime_error("makeTestSurface failed.");
+        }
+
+        RandRange byte(0, 255);
+        SdlLockSurface guard{surf};
+        for (int y = 0; y < size; ++y) {
+            auto p = static_cast<Uint8 *>(surf->pixels) + y * surf->pitch;
+            for (int x = 0; x < size; ++x, p += 4) {
+                const auto r = byte(gen);
+                if (r % 2 == 0) {
+                    sdlSetPixel(surf, p, magenta[r % 8 / 2]);
+                }
+                else {
+                    const SDL_Color c = {static_cast<Uint8>(r),
+                                         static_cast<Uint8>(byte(gen)),
+                                         static_cast<Uint8>(byte(gen)),
+                                         SDL_ALPHA_OPAQUE};
+                    sdlSetPixel(surf, p, c);
+                }
+            }
+        }
+        return surf;
+    }
+
+    void benchPixels()
+    {
+        std::minstd_rand gen{benchSeed};
+        for (auto size : {64, 256, 1024}) {
+            auto surf = makeTestSurface(size, gen);
+            const long long pixels = size * size;
+
+            run("sdlGetPixel/" + sizeName(size), "pixel", pixels, [&] {
+                SdlLockSurface guard{surf};
+                unsigned int sum = 0;
+                for (int y = 0; y < size; ++y) {
+                    auto p = static_cast<const Uint8 *>(surf->pixels) +
+                        y * surf->pitch;
+                    for (int x = 0; x < size; ++x, p += 4) {
+                        const auto c = sdlGetPixel(surf, p);
+                        sum += c.r + c.g + c.b;
+                    }
+                }
+                sink += sum;
+            });
+
+            run("sdlSetPixel/" + sizeName(size), "pixel", pixels, [&] {
+                SdlLockSurface guard{surf};
+                for (int y = 0; y < size; ++y) {
+                    auto p = static_cast<Uint8 *>(surf->pixels) +
+                        y * surf->pitch;
+                    for (int x = 0; x < size; ++x, p += 4) {
+                        const SDL_Color c = {static_cast<Uint8>(x),
+                                             static_cast<Uint8>(y),
+                                             0,
+                                             SDL_ALPHA_OPAQUE};
+                        sdlSetPixel(surf, p, c);
+                    }
+                }
+            });
+        }
+    }
+
+    void benchTeamColor()
+    {
+        std::minstd_rand gen{benchSeed};
+        for (auto size : {64, 256}) {
+            const auto surf = makeTestSurface(size, gen);
+            const long long pixels = size * size;
+
+            // Color the image once for every team.
+            for (auto numTeams : {2, 8}) {
+                std::ostringstream name;
+                name << "applyTeamColor/" << sizeName(size) << "/teams="
+                    << numTeams;
+                run(name.str(), "pixel", pixels * numTeams, [&] {
+                    for (int t = 0; t < numTeams; ++t) {
+                        sink += applyTeamColor(surf, t)->w;
+                    }
+                });
+            }
+
+            run("applyFlagColor/" + sizeName(size), "pixel", pixels, [&] {
+                sink += applyFlagColor(surf)->w;
+            });
+        }
+    }
+
+    // The region color lookups only happen while drawing, so measure them
+    // through drawTile.
+    void benchDrawTile()
+    {
+        const int mapWidth = 1280;
+        const int mapHeight = 768;
+        const int tileSize = 256;
+
+        auto dest = make_surface(SDL_CreateRGBSurface(0, tileSize, tileSize,
+                                                      32,
+                                                      0x00ff0000,
+                                                      0x0000ff00,
+                                                      0x000000ff,
+                                                      0xff000000));
+        const SDL_Rect tile = {mapWidth / 2 - tileSize / 2,
+                               mapHeight / 2 - tileSize / 2,
+                               tileSize,
+                               tileSize};
+
+        for (auto shape : {MapShape::GRID, MapShape::HEX}) {
+            for (auto numTeams : {2, 8}) {
+                std::minstd_rand gen{benchSeed};
+                SimpleMap smap{mapWidth, mapHeight, shape, numTeams};
+                const auto numRegions = smap.influence().numRegions();
+                RandRange region(0, numRegions - 1);
+                for (int id = 0; id < numTeams * 4; ++id) {
+                    smap.addEntity(MapEntity{id, region(gen), 8,
+                                             id % numTeams});
+                }
+                smap.update();
+
+                for (auto style : {MapStyle::FLAT, MapStyle::HEATMAP}) {
+                    smap.setStyle(style);
+                    smap.update();
+                    std::ostringstream name;
+                    name << "drawTile/" <<
+                        (shape == MapShape::GRID ? "grid" : "hex") << '/' <<
+                        (style == MapStyle::FLAT ? "flat" : "heatmap") <<
+                        "/teams=" << numTeams;
+                    run(name.str(), "pixel", tileSize * tileSize, [&] {
+                        smap.drawTile(0, tile, dest);
+                    });
+                }
+            }
+        }
+    }
+
+    // Influence is spread by update(), so each call moves one entity and
+    // recomputes the whole map.  That cost is reported per update rather than
+    // per entity, since it depends on the map size as much as the entity
+    // count.
+    void benchInfluence()
+    {
+        const int cols = 64;
+        const int rows = 64;
+
+        for (auto numTeams : {2, 8}) {
+            for (auto numEntities : {16, 128, 1024}) {
+                std::minstd_rand gen{benchSeed};
+                RandRange region(0, cols * rows - 1);
+                InfluenceMap imap{makeGridGraph(cols, rows), numTeams};
+                for (int id = 0; id < numEntities; ++id) {
+                    imap.addEntity(MapEntity{id, region(gen), 8,
+                                             id % numTeams});
+                }
+                imap.update();
+
+                std::ostringstream name;
+                name << "relaxInfluence/teams=" << numTeams << "/entities="
+                    << numEntities;
+                int next = 0;
+                run(name.str(), "update", 1, [&] {
+                    imap.moveEntity(next, region(gen));
+                    next = (next + 1) % numEntities;
+                    imap.update();
+                    sink += imap.changedRegions().size();
+                });
+            }
+
+            InfluenceMap imap{makeGridGraph(cols, rows), numTeams};
+            std::minstd_rand gen{benchSeed};
+            RandRange region(0, cols * rows - 1);
+            for (int id = 0; id < 64; ++id) {
+                imap.addEntity(MapEntity{id, region(gen), 8, id % numTeams});
+            }
+            imap.update();
+
+            std::ostringstream name;
+            name << "getOwner/teams=" << numTeams;
+            run(name.str(), "region", cols * rows, [&] {
+                unsigned int sum = 0;
+                for (int r = 0; r < cols * rows; ++r) {
+                    sum += imap.getOwner(r);
+                }
+                sink += sum;
+            });
+        }
+    }
+
+    // Return an empty map if the file can't be read.
+    std::map<std::string, double> loadBaseline(const char *filename)
+    {
+        std::map<std::string, double> baseline;
+        std::ifstream file{filename};
+        if (!file) {
+            std::cerr << "Error opening " << filename << std::endl;
+            return baseline;
+        }
+        const std::string json{std::istreambuf_iterator<char>(file),
+                               std::istreambuf_iterator<char>()};
+
+        rapidjson::Document doc;
+        doc.Parse<0>(json.c_str());
+        if (doc.HasParseError() || !doc.IsObject()) {
+            std::cerr << filename << " is not a benchmark baseline"
+                << std::endl;
+            return baseline;
+        }
+        for (auto m = doc.MemberBegin(); m != doc.MemberEnd(); ++m) {
+            if (m->value.IsNumber()) {
+                baseline[m->name.GetString()] = m->value.GetDouble();
+            }
+        }
+        return baseline;
+    }
+
+    bool saveResults(const char *filename)
+    {
+        std::ofstream file{filename};
+        file << "{\n";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            file << "    \"" << results[i].name << "\": " << results[i].ns
+                << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        file << "}\n";
+        file.close();
+        if (!file) {
+            std::cerr << "Error writing " << filename << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *saveFile = nullptr;
+    const char *baselineFile = nullptr;
+    for (int i = 1; i < argc; i += 2) {
+        const char **dest = nullptr;
+        if (strcmp(argv[i], "--save") == 0) {
+            dest = &saveFile;
+        }
+        else if (strcmp(argv[i], "--baseline") == 0) {
+            dest = &baselineFile;
+        }
+        else {
+            std::cerr << "Unknown option " << argv[i] << std::endl;
+            std::cerr << "Usage: bench [--save FILE] [--baseline FILE]"
+                << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        if (i + 1 == argc) {
+            std::cerr << "Option " << argv[i] << " needs a file name"
+                << std::endl;
+            std::cerr << "Usage: bench [--save FILE] [--baseline FILE]"
+                << std::endl;
+            return EXIT_FAILURE;
+        }
+        *dest = argv[i + 1];
+    }
+
+    std::map<std::string, double> baseline;
+    if (baselineFile) {
+        baseline = loadBaseline(baselineFile);
+        if (baseline.empty()) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    try {
+        benchPixels();
+        benchTeamColor();
+        benchDrawTile();
+        benchInfluence();
+    }
+    catch (std::runtime_error &e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    for (const auto &res : results) {
+        std::cout << res.name << ": " << res.ns << " ns/" << res.unit;
+        const auto iter = baseline.find(res.name);
+        if (iter != std::end(baseline) && iter->second > 0) {
+            const auto change = (res.ns - iter->second) / iter->second * 100;
+            std::cout << " (baseline " << iter->second << ", "
+                << (change >= 0 ? "+" : "") << std::round(change) << "%)";
+        }
+        std::cout << '\n';
+    }
+
+    if (saveFile && !saveResults(saveFile)) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
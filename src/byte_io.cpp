@@ -0,0 +1,149 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "byte_io.h"
+#include <cstring>
+
+void putU32(std::vector<unsigned char> &buf, unsigned int value)
+{
+    for (int i = 0; i < 4; ++i) {
+        buf.push_back((value >> (8 * i)) & 0xFF);
+    }
+}
+
+void putU64(std::vector<unsigned char> &buf, unsigned long long value)
+{
+    putU32(buf, value & 0xFFFFFFFF);
+    putU32(buf, value >> 32);
+}
+
+void putDouble(std::vector<unsigned char> &buf, double value)
+{
+    unsigned long long bits;
+    static_assert(sizeof(bits) == sizeof(value), "double isn't 64 bits");
+    memcpy(&bits, &value, sizeof(bits));
+    putU64(buf, bits);
+}
+
+void putVarint(std::vector<unsigned char> &buf, unsigned int value)
+{
+    while (value >= 0x80) {
+        buf.push_back((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    buf.push_back(value);
+}
+
+
+ByteReader::ByteReader(const unsigned char *data, std::size_t size)
+    : data_{data},
+    size_{size},
+    pos_{0},
+    isOk_{true}
+{
+}
+
+ByteReader::ByteReader(const std::vector<unsigned char> &buf)
+    : ByteReader(buf.data(), buf.size())
+{
+}
+
+unsigned long long ByteReader::u64()
+{
+    const unsigned long long low = u32();
+    return low | static_cast<unsigned long long>(u32()) << 32;
+}
+
+double ByteReader::f64()
+{
+    const auto bits = u64();
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+unsigned int ByteReader::varint()
+{
+    unsigned int value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        const auto p = take(1);
+        if (!p) {
+            return 0;
+        }
+        value |= static_cast<unsigned int>(*p & 0x7F) << shift;
+        if ((*p & 0x80) == 0) {
+            break;
+        }
+    }
+    return value;
+}
+
+std::string ByteReader::str(std::size_t length)
+{
+    if (length == 0) {
+        return {};
+    }
+    const auto p = take(length);
+    if (!p) {
+        return {};
+    }
+    return std::string(p, p + length);
+}
+
+void ByteReader::i32s(int *dest, std::size_t n)
+{
+    if (n == 0) {
+        return;
+    }
+    if (n > remaining() / 4) {
+        take(remaining() + 1);  // sets the failure flag
+        return;
+    }
+
+    const auto p = take(n * 4);
+    for (std::size_t i = 0; i < n; ++i) {
+        const auto q = p + i * 4;
+        dest[i] = static_cast<int>(q[0] | (q[1] << 8) | (q[2] << 16) |
+                                   (static_cast<unsigned int>(q[3]) << 24));
+    }
+}
+
+void ByteReader::skip(std::size_t n)
+{
+    if (n > 0) {
+        take(n);
+    }
+}
+
+void ByteReader::seek(std::size_t pos)
+{
+    if (pos > size_) {
+        isOk_ = false;
+        pos = size_;
+    }
+    pos_ = pos;
+}
+
+bool ByteReader::ok() const
+{
+    return isOk_;
+}
+
+bool ByteReader::atEnd() const
+{
+    return pos_ == size_;
+}
+
+std::size_t ByteReader::remaining() const
+{
+    return size_ - pos_;
+}
@@ -0,0 +1,99 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef BYTE_IO_H
+#define BYTE_IO_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Building blocks for the binary file formats.  Integers are little-endian
+// no matter what machine writes them.
+void putU32(std::vector<unsigned char> &buf, unsigned int value);
+void putU64(std::vector<unsigned char> &buf, unsigned long long value);
+void putDouble(std::vector<unsigned char> &buf, double value);
+
+// 7 bits at a time, low bits first, high bit set if more follow.
+void putVarint(std::vector<unsigned char> &buf, unsigned int value);
+
+
+// Reads values written by the functions above.  Reads past the end of the
+// data set the failure flag and return 0, so a whole record can be read
+// before checking ok() once.
+class ByteReader
+{
+public:
+    ByteReader(const unsigned char *data, std::size_t size);
+    explicit ByteReader(const std::vector<unsigned char> &buf);
+
+    unsigned int u32();
+    int i32();
+    unsigned long long u64();
+    double f64();
+    unsigned int varint();
+    std::string str(std::size_t length);
+
+    // Read n 32-bit integers into an array with one bounds check, for the
+    // big arrays in save files.
+    void i32s(int *dest, std::size_t n);
+
+    // Move ahead, or to an absolute offset from the start.
+    void skip(std::size_t n);
+    void seek(std::size_t pos);
+
+    bool ok() const;
+    bool atEnd() const;
+    std::size_t remaining() const;
+
+private:
+    // Return a pointer to the next n > 0 bytes and move past them, or null
+    // if there aren't that many left.
+    const unsigned char * take(std::size_t n);
+
+    const unsigned char *data_;
+    std::size_t size_;
+    std::size_t pos_;
+    bool isOk_;
+};
+
+
+// Fixed-size reads are small and called in tight loops, so they're defined
+// here where they can be inlined.
+inline const unsigned char * ByteReader::take(std::size_t n)
+{
+    if (n > size_ - pos_) {
+        isOk_ = false;
+        pos_ = size_;
+        return nullptr;
+    }
+    const auto p = data_ + pos_;
+    pos_ += n;
+    return p;
+}
+
+inline unsigned int ByteReader::u32()
+{
+    const auto p = take(4);
+    if (!p) {
+        return 0;
+    }
+    return p[0] | (p[1] << 8) | (p[2] << 16) |
+        (static_cast<unsigned int>(p[3]) << 24);
+}
+
+inline int ByteReader::i32()
+{
+    return static_cast<int>(u32());
+}
+
+#endif
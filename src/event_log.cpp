@@ -0,0 +1,223 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "event_log.h"
+#include "byte_io.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+    const char magic[4] = {'I', 'R', 'E', 'C'};
+    const unsigned int fileVersion = 1;
+    const unsigned int headerSize = 20;
+    const unsigned int entrySize = 20;
+
+    // Entries to collect before writing them out.
+    const unsigned int batchSize = 1024;
+}
+
+bool logEntryFromEvent(const SDL_Event &event, Uint32 ticks, LogEntry &entry)
+{
+    entry.ticks = ticks;
+    entry.data[0] = 0;
+    entry.data[1] = 0;
+    entry.data[2] = 0;
+
+    switch (event.type) {
+        case SDL_KEYUP:
+            entry.type = LogEntryType::KEY_UP;
+            entry.data[0] = event.key.keysym.sym;
+            return true;
+        case SDL_MOUSEMOTION:
+            entry.type = LogEntryType::MOUSE_MOTION;
+            entry.data[0] = event.motion.x;
+            entry.data[1] = event.motion.y;
+            return true;
+        case SDL_MOUSEBUTTONUP:
+            entry.type = LogEntryType::MOUSE_UP;
+            entry.data[0] = event.button.button;
+            entry.data[1] = event.button.x;
+            entry.data[2] = event.button.y;
+            return true;
+        case SDL_WINDOWEVENT:
+            if (event.window.event != SDL_WINDOWEVENT_EXPOSED) {
+                return false;
+            }
+            entry.type = LogEntryType::REDRAW;
+            return true;
+        case SDL_RENDER_TARGETS_RESET:
+            entry.type = LogEntryType::REDRAW;
+            return true;
+        case SDL_QUIT:
+            entry.type = LogEntryType::QUIT;
+            return true;
+    }
+
+    return false;
+}
+
+SDL_Event eventFromLogEntry(const LogEntry &entry)
+{
+    SDL_Event event;
+    SDL_zero(event);
+
+    switch (entry.type) {
+        case LogEntryType::KEY_UP:
+            event.type = SDL_KEYUP;
+            event.key.keysym.sym = entry.data[0];
+            break;
+        case LogEntryType::MOUSE_MOTION:
+            event.type = SDL_MOUSEMOTION;
+            event.motion.x = entry.data[0];
+            event.motion.y = entry.data[1];
+            break;
+        case LogEntryType::MOUSE_UP:
+            event.type = SDL_MOUSEBUTTONUP;
+            event.button.button = entry.data[0];
+            event.button.x = entry.data[1];
+            event.button.y = entry.data[2];
+            break;
+        case LogEntryType::REDRAW:
+            event.type = SDL_RENDER_TARGETS_RESET;
+            break;
+        case LogEntryType::QUIT:
+            event.type = SDL_QUIT;
+            break;
+        default:
+            break;  // not an input event
+    }
+
+    return event;
+}
+
+bool readEventLog(const std::string &filename, EventLogInfo &info,
+                  std::vector<LogEntry> &entries)
+{
+    std::ifstream file{filename, std::ios::binary};
+    if (!file) {
+        std::cerr << "Couldn't open event log " << filename << std::endl;
+        return false;
+    }
+    const std::vector<unsigned char> buf{std::istreambuf_iterator<char>(file),
+                                         std::istreambuf_iterator<char>()};
+
+    if (buf.size() < headerSize ||
+        !std::equal(magic, magic + 4, begin(buf)))
+    {
+        std::cerr << filename << " isn't an event log" << std::endl;
+        return false;
+    }
+
+    ByteReader in{buf};
+    in.skip(sizeof(magic));
+    if (in.u32() > fileVersion) {
+        std::cerr << filename << " is from a newer version" << std::endl;
+        return false;
+    }
+    info.shape = in.i32();
+    info.seed = in.u32();
+    info.numTeams = in.i32();
+
+    // A session that crashed can leave part of an entry at the end.
+    const auto numEntries = (buf.size() - headerSize) / entrySize;
+    entries.clear();
+    entries.reserve(numEntries);
+    for (unsigned int i = 0; i < numEntries; ++i) {
+        LogEntry entry;
+        entry.ticks = in.u32();
+        const auto type = in.u32();
+        if (type > static_cast<unsigned int>(LogEntryType::FRAME)) {
+            std::cerr << filename << " has an unknown entry type " << type
+                << std::endl;
+            return false;
+        }
+        entry.type = static_cast<LogEntryType>(type);
+        for (auto &d : entry.data) {
+            d = in.i32();
+        }
+        entries.push_back(entry);
+    }
+
+    return true;
+}
+
+
+EventRecorder::EventRecorder(const std::string &filename,
+                             const EventLogInfo &info)
+    : file_{filename, std::ios::binary},
+    buf_{}
+{
+    if (!file_) {
+        throw std::runtime_error("Couldn't create event log " + filename);
+    }
+
+    buf_.reserve(batchSize * entrySize);
+    for (auto c : magic) {
+        buf_.push_back(c);
+    }
+    putU32(buf_, fileVersion);
+    putU32(buf_, info.shape);
+    putU32(buf_, info.seed);
+    putU32(buf_, info.numTeams);
+    flush();
+}
+
+EventRecorder::~EventRecorder()
+{
+    flush();
+}
+
+bool EventRecorder::record(const SDL_Event &event, Uint32 ticks)
+{
+    LogEntry entry;
+    if (!logEntryFromEvent(event, ticks, entry)) {
+        return false;
+    }
+    add(entry);
+    return true;
+}
+
+void EventRecorder::record(LogEntryType type, Uint32 ticks, int data)
+{
+    const LogEntry entry = {ticks, type, {data, 0, 0}};
+    add(entry);
+}
+
+void EventRecorder::add(const LogEntry &entry)
+{
+    if (buf_.size() + entrySize > buf_.capacity()) {
+        flush();
+    }
+
+    putU32(buf_, entry.ticks);
+    putU32(buf_, static_cast<unsigned int>(entry.type));
+    for (auto d : entry.data) {
+        putU32(buf_, d);
+    }
+
+    // Quitting is the last thing recorded, so make sure it gets out.
+    if (entry.type == LogEntryType::QUIT) {
+        flush();
+    }
+}
+
+void EventRecorder::flush()
+{
+    if (buf_.empty()) {
+        return;
+    }
+    file_.write(reinterpret_cast<const char *>(buf_.data()), buf_.size());
+    file_.flush();
+    buf_.clear();
+}
@@ -0,0 +1,88 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include "sdl_utils.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Everything a replay needs to know about one moment of a recorded session.
+// Besides the input events the game handles, the log notes each time the
+// simulation stepped and each time a frame was drawn, so a replay does the
+// same work in the same order.
+enum class LogEntryType : Uint32
+{
+    KEY_UP,        // key code
+    MOUSE_MOTION,  // x, y
+    MOUSE_UP,      // button, x, y
+    REDRAW,        // window contents were lost
+    QUIT,
+    STEP,          // number of fixed steps simulated
+    FRAME
+};
+
+struct LogEntry
+{
+    Uint32 ticks;  // SDL ticks when it happened
+    LogEntryType type;
+    int data[3];
+};
+
+// How the recorded game was started.  Replays have to start the same way.
+struct EventLogInfo
+{
+    int shape;
+    unsigned int seed;
+    int numTeams;
+};
+
+// Convert an SDL event to a log entry.  Returns false for events the game
+// doesn't handle.
+bool logEntryFromEvent(const SDL_Event &event, Uint32 ticks, LogEntry &entry);
+
+// Rebuild the SDL event a log entry was made from.  Only the fields the game
+// reads are filled in.
+SDL_Event eventFromLogEntry(const LogEntry &entry);
+
+// Read a whole event log.  Returns false and prints an error if the file is
+// missing, truncated, or from a newer version.
+bool readEventLog(const std::string &filename, EventLogInfo &info,
+                  std::vector<LogEntry> &entries);
+
+
+// Appends entries to an event log as a session goes.  Entries are buffered
+// and written in batches, without allocating memory once the file is open.
+class EventRecorder
+{
+public:
+    EventRecorder(const std::string &filename, const EventLogInfo &info);
+    ~EventRecorder();
+
+    EventRecorder(const EventRecorder &) = delete;
+    EventRecorder & operator=(const EventRecorder &) = delete;
+
+    // Returns false if the event isn't one the game handles.
+    bool record(const SDL_Event &event, Uint32 ticks);
+    void record(LogEntryType type, Uint32 ticks, int data = 0);
+
+private:
+    void add(const LogEntry &entry);
+    void flush();
+
+    std::ofstream file_;
+    std::vector<unsigned char> buf_;
+};
+
+#endif
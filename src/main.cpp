@@ -10,141 +10,768 @@
 
     See the COPYING.txt file for more details.
 */
+#include "FrameScheduler.h"
 #include "GameWindow.h"
 #include "SdlTextureStream.h"
 #include "SdlWindow.h"
 #include "SimpleMap.h"
+#include "SurfacePool.h"
+#include "ThreadPool.h"
+#include "alloc_counter.h"
+#include "event_log.h"
+#include "save_file.h"
+#include "scenario.h"
 #include "sdl_utils.h"
 #include "team_color.h"
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace
 {
     const int winWidth = 1280;
     const int winHeight = 768;
+    const int mapWidth = winWidth * 4;
+    const int mapHeight = winHeight * 4;
+    const int scrollStep = 64;
+    const double zoomStep = 1.25;
+    const int stepsPerSec = 60;
+
+    // Frames to draw before checking that the main loop no longer allocates.
+    const int warmUpFrames = 60;
+
+    const char *quickSaveFile = "quicksave.sav";
+    const char *checkpointFile = "checkpoint.sav";
+
+    // What the game starts with if no scenario file is given.
+    Scenario defaultScenario()
+    {
+        Scenario scn;
+        scn.shape = -1;
+        scn.hasSeed = false;
+        scn.seed = 0;
+        scn.numTeams = 2;
+        scn.sprites = {
+            {"cavalier.png", false},
+            {"orc-grunt.png", false},
+            {"flag.png", true}
+        };
+        scn.entities = {
+            {{1, 1, 8, 0}, 0},
+            {{2, 30, 8, 1}, 1},
+            {{3, 24, 0, noTeam}, 2}
+        };
+        return scn;
+    }
+
+    // Shapes read from files are plain numbers until checked.
+    bool isMapShape(int shape)
+    {
+        return shape >= static_cast<int>(MapShape::GRID) &&
+            shape <= static_cast<int>(MapShape::VORONOI);
+    }
+
+    // FNV-1a, good enough to tell whether two runs ended up the same.
+    unsigned long long hashBytes(const std::vector<unsigned char> &buf)
+    {
+        auto hash = 14695981039346656037ULL;
+        for (auto b : buf) {
+            hash ^= b;
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
 }
 
 
 class Game
 {
 public:
-    Game();
-    void loadScenario();
+    Game(MapShape shape, int numTeams, unsigned int seed);
+
+    // Entities outside the map or on teams that don't exist are skipped.
+    void loadScenario(const Scenario &scn);
+
+    // Advance the simulation by one fixed step.
     void update();
 
+    // Draw a frame if anything changed.
+    void draw();
+
+    // True if there's nothing to simulate or draw until the next event.
+    bool isIdle() const;
+    bool needsRedraw() const;
+
     void handleKeyUp(const SDL_KeyboardEvent &event);
 
+    // Track what's under the mouse.  Click an entity to select it, then
+    // click a region to move it there.
+    void handleMouseMotion(const SDL_MouseMotionEvent &event);
+    void handleMouseUp(const SDL_MouseButtonEvent &event);
+
+    // The window contents were lost and need to be drawn from scratch.
+    void redrawAll();
+
+    // Write the map and view to a file.  The file is written on a background
+    // thread from a copy that later moves can't change.
+    void save(const std::string &filename);
+
+    // Put everything back the way a save file had it.  The save has to be
+    // from the same map.
+    bool restore(const SaveInfo &info, InfluenceState state);
+
+    // Where animations get the current time.  See GameWindow::setClock().
+    void setClock(GameWindow::Clock clock);
+
+    // Replays ignore quicksave and quickload.  The quicksave file on disk
+    // isn't part of the recording, and replays shouldn't overwrite it.
+    void setReplaying(bool isReplaying);
+
+    // Hash of everything a save file would hold.  Two runs fed the same
+    // events should always agree.
+    unsigned long long stateHash();
+
 private:
+    SaveInfo saveInfo() const;
+
+    // Show only the entities the current viewer can see.
+    void updateEntityVisibility();
+
+    void moveEntity(int id, int toReg);
+
+
     bool isDirty_;
+    bool isMapDirty_;
     GameWindow win_;
+    ThreadPool pool_;
     SimpleMap advMap_;
+    SurfacePool surfaces_;
+    std::vector<SDL_Rect> dirtyRects_;
+    SaveWriter saver_;
+    int selectedEntity_;
+    bool isReplaying_;
 };
 
-Game::Game()
+Game::Game(MapShape shape, int numTeams, unsigned int seed)
     : isDirty_{true},
+    isMapDirty_{true},
     win_{winWidth, winHeight, "Influence Map Test"},
-    advMap_{winWidth, winHeight, 2, win_.getBlankMap()}
+    pool_{},
+    advMap_{mapWidth, mapHeight, shape, numTeams, 4, &pool_, seed},
+    surfaces_{},
+    dirtyRects_{},
+    saver_{},
+    selectedEntity_{-1},
+    isReplaying_{false}
 {
+    win_.setMap(advMap_.width(), advMap_.height(), advMap_.numLevels(),
+                [this] (int level, const SDL_Rect &rect, SdlSurface &dest) {
+                    advMap_.drawTile(level, rect, dest);
+                });
+    dirtyRects_.reserve(advMap_.influence().numRegions());
 }
 
-void Game::loadScenario()
+void Game::loadScenario(const Scenario &scn)
 {
-    advMap_.addEntity(MapEntity{1, 1, 8, Team::BLUE});
-    advMap_.addEntity(MapEntity{2, 30, 8, Team::RED});
-    advMap_.addEntity(MapEntity{3, 24, 0, Team::NONE});
+    // Load each image once, no matter how many entities use it.
+    std::vector<TeamSprite> sprites;
+    for (const auto &s : scn.sprites) {
+        auto img = sdlLoadImage(s.image);
+        if (img && s.isFlag) {
+            img = applyFlagColor(img, surfaces_);
+        }
+        sprites.emplace_back(img);
+    }
 
-    auto img1 = applyTeamColor(sdlLoadImage("cavalier.png"), Team::BLUE);
-    win_.addEntity(1, advMap_.pixelFromRegion(advMap_.getRegion(1)), img1);
-    auto img2 = applyTeamColor(sdlLoadImage("orc-grunt.png"), Team::RED);
-    win_.addEntity(2, advMap_.pixelFromRegion(advMap_.getRegion(2)), img2);
-    auto img3 = applyTeamColor(applyFlagColor(sdlLoadImage("flag.png")), Team::NONE);
-    win_.addEntity(3, advMap_.pixelFromRegion(advMap_.getRegion(3)), img3);
+    const auto numRegions = advMap_.influence().numRegions();
+    const auto numTeams = advMap_.influence().numTeams();
+    for (const auto &se : scn.entities) {
+        const auto &e = se.entity;
+        if (e.region < 0 || e.region >= numRegions ||
+            e.team < noTeam || e.team >= numTeams)
+        {
+            std::cerr << "Skipping entity " << e.id
+                << ", its region or team is out of range." << std::endl;
+            continue;
+        }
+
+        advMap_.addEntity(e);
+        if (se.sprite >= 0 && se.sprite < static_cast<int>(sprites.size()) &&
+            sprites[se.sprite])
+        {
+            win_.addEntity(e.id, advMap_.pixelFromRegion(e.region),
+                           sprites[se.sprite].get(e.team));
+        }
+    }
 }
 
 void Game::update()
 {
-    if (!isDirty_) {
+    if (!isMapDirty_) {
+        return;
+    }
+
+    advMap_.update();
+    for (int level = 0; level < advMap_.numLevels(); ++level) {
+        advMap_.dirtyRects(level, dirtyRects_);
+        for (const auto &rect : dirtyRects_) {
+            win_.invalidateMap(level, rect);
+        }
+    }
+    updateEntityVisibility();
+    isMapDirty_ = false;
+}
+
+void Game::draw()
+{
+    if (!needsRedraw()) {
         return;
     }
 
-    win_.updateMap(advMap_.update());
     win_.draw();
     isDirty_ = false;
 }
 
+bool Game::isIdle() const
+{
+    return !needsRedraw() && !isMapDirty_;
+}
+
+bool Game::needsRedraw() const
+{
+    return isDirty_ || win_.isAnimating();
+}
+
 void Game::handleKeyUp(const SDL_KeyboardEvent &event)
 {
     auto rPlayer1 = advMap_.getRegion(1);
     auto rPlayer2 = advMap_.getRegion(2);
+    const auto lastRegion = advMap_.influence().numRegions() - 1;
 
     switch (event.keysym.sym) {
         case SDLK_a:
             if (rPlayer1 > 0) {
-                --rPlayer1;
-                win_.moveEntity(1, advMap_.pixelFromRegion(rPlayer1));
-                advMap_.moveEntity(1, rPlayer1);
-                isDirty_ = true;
+                moveEntity(1, rPlayer1 - 1);
             }
             break;
         case SDLK_d:
-            if (rPlayer1 < 31) {
-                ++rPlayer1;
-                win_.moveEntity(1, advMap_.pixelFromRegion(rPlayer1));
-                advMap_.moveEntity(1, rPlayer1);
-                isDirty_ = true;
+            if (rPlayer1 < lastRegion) {
+                moveEntity(1, rPlayer1 + 1);
             }
             break;
         case SDLK_h:
             if (rPlayer2 > 0) {
-                --rPlayer2;
-                win_.moveEntity(2, advMap_.pixelFromRegion(rPlayer2));
-                advMap_.moveEntity(2, rPlayer2);
-                isDirty_ = true;
+                moveEntity(2, rPlayer2 - 1);
             }
             break;
         case SDLK_l:
-            if (rPlayer2 < 31) {
-                ++rPlayer2;
-                win_.moveEntity(2, advMap_.pixelFromRegion(rPlayer2));
-                advMap_.moveEntity(2, rPlayer2);
+            if (rPlayer2 < lastRegion) {
+                moveEntity(2, rPlayer2 + 1);
+            }
+            break;
+        case SDLK_m:
+            advMap_.setStyle(advMap_.style() == MapStyle::FLAT ?
+                             MapStyle::HEATMAP : MapStyle::FLAT);
+            win_.invalidateMap();
+            isDirty_ = true;
+            break;
+        case SDLK_v:
+            // Cycle through each team's view, then back to seeing everything.
+            {
+                auto viewer = advMap_.viewer() + 1;
+                if (viewer >= advMap_.influence().numTeams()) {
+                    viewer = -1;
+                }
+                advMap_.setViewer(viewer);
+                win_.invalidateMap();
+                updateEntityVisibility();
                 isDirty_ = true;
             }
             break;
+        case SDLK_F5:
+            if (!isReplaying_) {
+                save(quickSaveFile);
+            }
+            break;
+        case SDLK_F9:
+            if (!isReplaying_) {
+                // Don't read a quicksave that's still being written.
+                saver_.wait();
+                SaveInfo info;
+                InfluenceState state;
+                if (loadSaveFile(quickSaveFile, info, state)) {
+                    restore(info, std::move(state));
+                }
+            }
+            break;
+        case SDLK_UP:
+            win_.scroll(0, -scrollStep);
+            isDirty_ = true;
+            break;
+        case SDLK_DOWN:
+            win_.scroll(0, scrollStep);
+            isDirty_ = true;
+            break;
+        case SDLK_LEFT:
+            win_.scroll(-scrollStep, 0);
+            isDirty_ = true;
+            break;
+        case SDLK_RIGHT:
+            win_.scroll(scrollStep, 0);
+            isDirty_ = true;
+            break;
+        case SDLK_EQUALS:
+            win_.zoom(zoomStep);
+            isDirty_ = true;
+            break;
+        case SDLK_MINUS:
+            win_.zoom(1.0 / zoomStep);
+            isDirty_ = true;
+            break;
     }
 }
 
+void Game::handleMouseMotion(const SDL_MouseMotionEvent &event)
+{
+    const SDL_Point screen = {event.x, event.y};
+    const auto entity = win_.entityAt(screen);
+    if (entity != win_.hoverEntity()) {
+        win_.setHoverEntity(entity);
+        isDirty_ = true;
+    }
+}
+
+void Game::handleMouseUp(const SDL_MouseButtonEvent &event)
+{
+    if (event.button != SDL_BUTTON_LEFT) {
+        return;
+    }
+
+    // Motion events don't cover clicks without moving the mouse first.
+    const SDL_Point screen = {event.x, event.y};
+    const auto entity = win_.entityAt(screen);
+    const auto region = advMap_.regionAt(win_.mapPixelAt(screen));
+
+    if (entity >= 0) {
+        selectedEntity_ = entity;
+    }
+    else if (selectedEntity_ >= 0 && region >= 0) {
+        moveEntity(selectedEntity_, region);
+        selectedEntity_ = -1;
+    }
+}
+
+void Game::redrawAll()
+{
+    win_.damageAll();
+    isDirty_ = true;
+}
+
+void Game::save(const std::string &filename)
+{
+    // Influence has to be up to date with any moves made since the last step.
+    update();
+    saver_.save(filename, saveInfo(), advMap_.influence().sharedState());
+}
+
+SaveInfo Game::saveInfo() const
+{
+    return {
+        advMap_.width(),
+        advMap_.height(),
+        static_cast<int>(advMap_.shape()),
+        advMap_.seed(),
+        advMap_.influence().numTeams(),
+        advMap_.numLevels(),
+        advMap_.viewer(),
+        static_cast<int>(advMap_.style()),
+        win_.viewX(),
+        win_.viewY(),
+        win_.zoomLevel()
+    };
+}
+
+bool Game::restore(const SaveInfo &info, InfluenceState state)
+{
+    const auto shape = static_cast<int>(advMap_.shape());
+    const auto numTeams = advMap_.influence().numTeams();
+    if (info.mapWidth != advMap_.width() ||
+        info.mapHeight != advMap_.height() ||
+        info.shape != shape ||
+        (advMap_.shape() == MapShape::VORONOI && info.seed != advMap_.seed()) ||
+        info.numTeams != numTeams ||
+        info.numLevels != advMap_.numLevels() ||
+        info.viewer < -1 || info.viewer >= numTeams ||
+        (info.style != static_cast<int>(MapStyle::FLAT) &&
+         info.style != static_cast<int>(MapStyle::HEATMAP)))
+    {
+        std::cerr << "Saved game is from a different map." << std::endl;
+        return false;
+    }
+
+    // Set the style first so restoring builds the right heatmap.
+    advMap_.setStyle(static_cast<MapStyle>(info.style));
+    if (!advMap_.restore(std::move(state))) {
+        std::cerr << "Saved game doesn't match this map." << std::endl;
+        return false;
+    }
+    advMap_.setViewer(info.viewer);
+
+    for (const auto &e : advMap_.influence().entities()) {
+        win_.placeEntity(e.id, advMap_.pixelFromRegion(e.region));
+    }
+    win_.setView(info.viewX, info.viewY, info.zoom);
+    win_.invalidateMap();
+    updateEntityVisibility();
+    selectedEntity_ = -1;
+    isDirty_ = true;
+    isMapDirty_ = false;
+    return true;
+}
+
+void Game::setClock(GameWindow::Clock clock)
+{
+    win_.setClock(std::move(clock));
+}
+
+void Game::setReplaying(bool isReplaying)
+{
+    isReplaying_ = isReplaying;
+}
+
+unsigned long long Game::stateHash()
+{
+    update();
+    const auto &state = *advMap_.influence().sharedState();
+    return hashBytes(encodeSave(saveInfo(), state));
+}
+
+void Game::moveEntity(int id, int toReg)
+{
+    win_.moveEntity(id, advMap_.pixelFromRegion(toReg));
+    advMap_.moveEntity(id, toReg);
+    isDirty_ = true;
+    isMapDirty_ = true;
+}
+
+void Game::updateEntityVisibility()
+{
+    for (const auto &e : advMap_.influence().entities()) {
+        win_.setEntityVisible(e.id, advMap_.isVisible(e.region));
+    }
+}
+
+
+void printFrameStats(const FrameStats &stats)
+{
+    std::cout << "Frames drawn: " << stats.frames
+        << "\nFrame interval (ms): avg " << stats.avgInterval
+        << ", p95 " << stats.p95Interval
+        << ", max " << stats.maxInterval
+        << "\nDraw time (ms): avg " << stats.avgDraw
+        << ", max " << stats.maxDraw << std::endl;
+}
+
+// Pass an event to the game.  Returns false if it's time to quit.
+bool handleEvent(Game &game, const SDL_Event &event)
+{
+    switch (event.type) {
+        case SDL_KEYUP:
+            game.handleKeyUp(event.key);
+            break;
+        case SDL_MOUSEMOTION:
+            game.handleMouseMotion(event.motion);
+            break;
+        case SDL_MOUSEBUTTONUP:
+            game.handleMouseUp(event.button);
+            break;
+        case SDL_WINDOWEVENT:
+            if (event.window.event == SDL_WINDOWEVENT_EXPOSED) {
+                game.redrawAll();
+            }
+            break;
+        case SDL_RENDER_TARGETS_RESET:
+            game.redrawAll();
+            break;
+        case SDL_QUIT:
+            return false;
+    }
+    return true;
+}
+
+// Feed a recorded session back to the game as fast as it will go.  Each
+// frame's time covers everything done since the frame before it.
+int replay(Game &game, const std::vector<LogEntry> &entries,
+           const char *timingsFile)
+{
+    Uint32 now = 0;
+    game.setClock([&now] { return now; });
+    game.setReplaying(true);
+
+    std::vector<double> frameTimes;
+    frameTimes.reserve(count_if(begin(entries), end(entries),
+        [] (const LogEntry &entry) {
+            return entry.type == LogEntryType::FRAME;
+        }));
+    const auto ticksPerMs = SDL_GetPerformanceFrequency() / 1000.0;
+    const auto startTime = SDL_GetPerformanceCounter();
+    auto frameStart = startTime;
+
+    int numEvents = 0;
+    for (const auto &entry : entries) {
+        now = entry.ticks;
+        if (entry.type == LogEntryType::STEP) {
+            for (int steps = entry.data[0]; steps > 0; --steps) {
+                game.update();
+            }
+        }
+        else if (entry.type == LogEntryType::FRAME) {
+            game.draw();
+            const auto frameEnd = SDL_GetPerformanceCounter();
+            frameTimes.push_back((frameEnd - frameStart) / ticksPerMs);
+            frameStart = frameEnd;
+        }
+        else {
+            ++numEvents;
+            if (!handleEvent(game, eventFromLogEntry(entry))) {
+                break;
+            }
+        }
+    }
+    const auto totalMs = (SDL_GetPerformanceCounter() - startTime) /
+        ticksPerMs;
+
+    if (timingsFile) {
+        std::ofstream file{timingsFile};
+        if (!file) {
+            std::cerr << "Couldn't write frame times to " << timingsFile
+                << std::endl;
+            return EXIT_FAILURE;
+        }
+        file << "frame,ms\n";
+        for (std::size_t i = 0; i < frameTimes.size(); ++i) {
+            file << i << ',' << frameTimes[i] << '\n';
+        }
+    }
+
+    std::cout << "Replayed " << numEvents << " events, "
+        << frameTimes.size() << " frames in " << totalMs << " ms\n";
+    if (!frameTimes.empty()) {
+        auto sorted = frameTimes;
+        std::sort(std::begin(sorted), std::end(sorted));
+        auto total = 0.0;
+        for (auto t : sorted) {
+            total += t;
+        }
+        std::cout << "Frame time (ms): avg " << total / sorted.size()
+            << ", p50 " << sorted[sorted.size() / 2]
+            << ", p95 " << sorted[sorted.size() * 95 / 100]
+            << ", max " << sorted.back() << '\n';
+    }
+    std::cout << "State hash: " << std::hex << std::setw(16)
+        << std::setfill('0') << game.stateHash() << std::endl;
+    return EXIT_SUCCESS;
+}
 
 int real_main(int argc, char **argv)
 {
-    Game game;
-    game.loadScenario();
+    // Usage: game [--max-fps N] [--hex | --voronoi] [--seed N]
+    //             [--scenario FILE] [--checkpoint SECONDS] [--load FILE]
+    //             [--record FILE | --replay FILE [--frame-times FILE]]
+    // Without a frame cap, drawing is paced by vsync.  Without a seed, every
+    // Voronoi map is different.  A scenario's map settings override the
+    // command line, and loading a save uses the map it came from.  F5 saves
+    // to quicksave.sav and F9 loads it.
+    //
+    // Recording writes every event the game handles to a file.  Replaying it
+    // with the same scenario and save runs the session again without a
+    // visible window as fast as possible, then prints frame times and a hash
+    // of the final state.  Frame times can also be written as CSV.
+    int maxFps = 0;
+    auto seed = static_cast<unsigned int>(std::time(nullptr));
+    auto shape = MapShape::GRID;
+    Uint32 checkpointMs = 0;
+    const char *loadFile = nullptr;
+    const char *scenarioFile = nullptr;
+    const char *recordFile = nullptr;
+    const char *replayFile = nullptr;
+    const char *timingsFile = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--max-fps") == 0 && i + 1 < argc) {
+            maxFps = std::max(atoi(argv[++i]), 0);
+        }
+        else if (strcmp(argv[i], "--hex") == 0) {
+            shape = MapShape::HEX;
+        }
+        else if (strcmp(argv[i], "--voronoi") == 0) {
+            shape = MapShape::VORONOI;
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            checkpointMs = std::max(atoi(argv[++i]), 0) * 1000;
+        }
+        else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+            loadFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--scenario") == 0 && i + 1 < argc) {
+            scenarioFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "--frame-times") == 0 && i + 1 < argc) {
+            timingsFile = argv[++i];
+        }
+    }
+
+    auto scenario = defaultScenario();
+    if (scenarioFile && !loadScenario(scenarioFile, scenario)) {
+        return EXIT_FAILURE;
+    }
+    if (scenario.shape >= 0) {
+        if (!isMapShape(scenario.shape)) {
+            std::cerr << scenarioFile << " has an unknown map shape"
+                << std::endl;
+            return EXIT_FAILURE;
+        }
+        shape = static_cast<MapShape>(scenario.shape);
+    }
+    if (scenario.hasSeed) {
+        seed = scenario.seed;
+    }
+
+    SaveInfo saveInfo;
+    InfluenceState saveState;
+    if (loadFile) {
+        if (!loadSaveFile(loadFile, saveInfo, saveState)) {
+            return EXIT_FAILURE;
+        }
+        if (!isMapShape(saveInfo.shape)) {
+            std::cerr << loadFile << " has an unknown map shape" << std::endl;
+            return EXIT_FAILURE;
+        }
+        shape = static_cast<MapShape>(saveInfo.shape);
+        seed = saveInfo.seed;
+    }
+
+    // A replay has to build the same map the recording did.
+    EventLogInfo logInfo;
+    std::vector<LogEntry> logEntries;
+    if (replayFile) {
+        if (!readEventLog(replayFile, logInfo, logEntries)) {
+            return EXIT_FAILURE;
+        }
+        if (!isMapShape(logInfo.shape) ||
+            logInfo.numTeams != scenario.numTeams)
+        {
+            std::cerr << replayFile << " was recorded with a different "
+                "scenario" << std::endl;
+            return EXIT_FAILURE;
+        }
+        shape = static_cast<MapShape>(logInfo.shape);
+        seed = logInfo.seed;
+    }
+    else if (maxFps == 0) {
+        SDL_SetHint(SDL_HINT_RENDER_VSYNC, "1");
+    }
+
+    Game game{shape, scenario.numTeams, seed};
+    game.loadScenario(scenario);
+    if (loadFile && !game.restore(saveInfo, std::move(saveState))) {
+        return EXIT_FAILURE;
+    }
+    if (replayFile) {
+        return replay(game, logEntries, timingsFile);
+    }
+
+    std::unique_ptr<EventRecorder> recorder;
+    if (recordFile) {
+        const EventLogInfo info = {
+            static_cast<int>(shape),
+            seed,
+            scenario.numTeams
+        };
+        recorder.reset(new EventRecorder{recordFile, info});
+    }
+
+    // Animations read the time once per event or frame, so recording it then
+    // is enough for a replay to animate exactly the same way.
+    Uint32 now = SDL_GetTicks();
+    game.setClock([&now] { return now; });
+
+    FrameScheduler scheduler{stepsPerSec, maxFps};
+    auto lastCheckpoint = SDL_GetTicks();
 
     bool isDone = false;
+    int framesDrawn = 0;
     SDL_Event event;
     while (!isDone) {
-        while (SDL_PollEvent(&event)) {
-            switch (event.type) {
-                case SDL_KEYUP:
-                    game.handleKeyUp(event.key);
-                    break;
-                case SDL_QUIT:
-                    isDone = true;
-                    break;
+        if (scheduler.waitEvent(event, game.isIdle())) {
+            now = SDL_GetTicks();
+            if (recorder) {
+                recorder->record(event, now);
             }
+            isDone = !handleEvent(game, event);
+            continue;  // handle everything queued up before moving on
+        }
+
+        if (checkpointMs > 0 &&
+            SDL_GetTicks() - lastCheckpoint >= checkpointMs)
+        {
+            game.save(checkpointFile);
+            lastCheckpoint = SDL_GetTicks();
         }
 
-        game.update();
-        SDL_Delay(1);
+        // Once warmed up, simulating and drawing only reuse memory they
+        // already have.  Checked in builds with COUNT_ALLOCS.
+        NoAllocGuard guard{framesDrawn >= warmUpFrames};
+        const auto steps = scheduler.stepsDue();
+        if (recorder && steps > 0) {
+            recorder->record(LogEntryType::STEP, SDL_GetTicks(), steps);
+        }
+        for (int i = 0; i < steps; ++i) {
+            game.update();
+        }
+
+        if (game.needsRedraw() && scheduler.frameDue()) {
+            now = SDL_GetTicks();
+            if (recorder) {
+                recorder->record(LogEntryType::FRAME, now);
+            }
+            scheduler.beginFrame();
+            game.draw();
+            scheduler.endFrame();
+            ++framesDrawn;
+        }
     }
 
+    printFrameStats(scheduler.stats());
     return EXIT_SUCCESS;
 }
 
 int main(int argc, char **argv)  // two-arg form required by SDL
 {
     try {
+        // Replays don't need a window or sound, so use SDL's stand-in
+        // drivers.  Drawing still goes through the software renderer.
+        for (int i = 1; i < argc; ++i) {
+            if (strcmp(argv[i], "--replay") == 0) {
+                SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+                SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+            }
+        }
         sdlInit();
         return real_main(argc, argv);
     }
@@ -0,0 +1,192 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "map_file.h"
+#include "byte_io.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace
+{
+    const char magic[4] = {'I', 'M', 'A', 'P'};
+    const unsigned int fileVersion = 1;
+
+    // Far bigger than any playable map, but small enough that a corrupt size
+    // can't ask for gigabytes of labels.
+    const unsigned long long maxPixels = 1 << 26;
+}
+
+GeneratedMap generateMap(int width, int height, unsigned int seed)
+{
+    GeneratedMap map;
+    map.seed = seed;
+    map.width = width;
+    map.height = height;
+    map.centers = randomCenters(width, height, seed);
+
+    const auto cells = makeVoronoi(map.centers, width, height);
+    map.labels = labelVoronoi(cells, width, height);
+    map.graph = graphFromVoronoi(cells);
+    return map;
+}
+
+void appendMapHeader(std::vector<unsigned char> &buf, int numMaps)
+{
+    buf.insert(end(buf), std::begin(magic), std::end(magic));
+    putU32(buf, fileVersion);
+    putU32(buf, numMaps);
+}
+
+void appendMapRecord(std::vector<unsigned char> &buf, const GeneratedMap &map)
+{
+    putU32(buf, map.seed);
+    putVarint(buf, map.width);
+    putVarint(buf, map.height);
+
+    putVarint(buf, map.centers.size());
+    for (const auto &c : map.centers) {
+        putVarint(buf, c.x);
+        putVarint(buf, c.y);
+    }
+
+    for (int r = 0; r < map.graph.size(); ++r) {
+        putVarint(buf, map.graph.numNeighbors(r));
+        for (auto nbr : map.graph.neighbors(r)) {
+            putVarint(buf, nbr);
+        }
+    }
+
+    // Runs never cross the end of a row, so the reader can check each row
+    // adds up to the map width.
+    for (int y = 0; y < map.height; ++y) {
+        auto a = y * map.width;
+        const auto rowEnd = a + map.width;
+        while (a < rowEnd) {
+            const auto label = map.labels[a];
+            const auto runStart = a;
+            while (a < rowEnd && map.labels[a] == label) {
+                ++a;
+            }
+            putVarint(buf, label);
+            putVarint(buf, a - runStart);
+        }
+    }
+}
+
+bool readMapFile(const std::string &filename, std::vector<GeneratedMap> &maps)
+{
+    std::ifstream file{filename, std::ios::binary};
+    if (!file) {
+        std::cerr << "Error opening " << filename << std::endl;
+        return false;
+    }
+    const std::vector<unsigned char> buf{std::istreambuf_iterator<char>(file),
+                                         std::istreambuf_iterator<char>()};
+
+    if (buf.size() < sizeof(magic) ||
+        !std::equal(std::begin(magic), std::end(magic), begin(buf)))
+    {
+        std::cerr << filename << " is not a map file" << std::endl;
+        return false;
+    }
+
+    ByteReader in{buf};
+    in.skip(sizeof(magic));
+    const auto version = in.u32();
+    if (version != fileVersion) {
+        std::cerr << filename << " has unsupported version " << version
+            << std::endl;
+        return false;
+    }
+
+    // Every count is checked against the bytes left before anything is sized
+    // by it.  Each center, neighbor, and label run takes at least one byte
+    // per number, so a count bigger than that can't be right.
+    const auto numMaps = in.u32();
+    maps.clear();
+    for (unsigned int m = 0; m < numMaps && in.ok(); ++m) {
+        GeneratedMap map;
+        map.seed = in.u32();
+        const auto width = in.varint();
+        const auto height = in.varint();
+        if (width == 0 || height == 0 ||
+            static_cast<unsigned long long>(width) * height > maxPixels ||
+            height > in.remaining() / 2)
+        {
+            std::cerr << filename << ": bad map size in map " << m
+                << std::endl;
+            return false;
+        }
+        map.width = width;
+        map.height = height;
+
+        const auto numRegions = in.varint();
+        if (numRegions > in.remaining() / 2) {
+            std::cerr << filename << ": bad region count in map " << m
+                << std::endl;
+            return false;
+        }
+        map.centers.reserve(numRegions);
+        for (unsigned int r = 0; r < numRegions && in.ok(); ++r) {
+            const int x = in.varint();
+            const int y = in.varint();
+            map.centers.push_back(MapPoint{x, y});
+        }
+
+        std::vector<std::vector<int>> adjacency(numRegions);
+        for (unsigned int r = 0; r < numRegions && in.ok(); ++r) {
+            const auto numNbrs = in.varint();
+            if (numNbrs > in.remaining()) {
+                std::cerr << filename << ": bad neighbor count in map " << m
+                    << std::endl;
+                return false;
+            }
+            for (unsigned int i = 0; i < numNbrs && in.ok(); ++i) {
+                const auto nbr = in.varint();
+                if (nbr >= numRegions) {
+                    std::cerr << filename << ": bad neighbor in map " << m
+                        << std::endl;
+                    return false;
+                }
+                adjacency[r].push_back(nbr);
+            }
+        }
+        map.graph = RegionGraph{adjacency};
+
+        // Labels grow as runs are decoded rather than being reserved up front,
+        // since the size alone says nothing about how much data follows.
+        for (int y = 0; y < map.height && in.ok(); ++y) {
+            unsigned int rowLen = 0;
+            while (rowLen < width && in.ok()) {
+                const auto label = in.varint();
+                const auto run = in.varint();
+                if (label >= numRegions || run == 0 || run > width - rowLen) {
+                    std::cerr << filename << ": bad label run in map " << m
+                        << std::endl;
+                    return false;
+                }
+                map.labels.insert(end(map.labels), run, label);
+                rowLen += run;
+            }
+        }
+
+        maps.push_back(std::move(map));
+    }
+
+    if (!in.ok() || !in.atEnd()) {
+        std::cerr << filename << " is truncated or corrupt" << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,46 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef MAP_FILE_H
+#define MAP_FILE_H
+
+#include "voronoi.h"
+#include <string>
+#include <vector>
+
+// Everything needed to play on a generated map.
+struct GeneratedMap
+{
+    unsigned int seed;
+    int width;
+    int height;
+    std::vector<MapPoint> centers;
+    std::vector<int> labels;  // region of each pixel, row by row
+    RegionGraph graph;
+};
+
+// Build a Voronoi map from a seed.  Depends on nothing else, so maps can be
+// generated on any number of threads with identical results.
+GeneratedMap generateMap(int width, int height, unsigned int seed);
+
+// Map files start with a header giving the number of maps, followed by one
+// record per map.  Integers are little-endian; counts and run lengths are
+// stored as variable-length integers, and labels are run-length encoded
+// along each row, so a typical map takes a few kilobytes.
+void appendMapHeader(std::vector<unsigned char> &buf, int numMaps);
+void appendMapRecord(std::vector<unsigned char> &buf, const GeneratedMap &map);
+
+// Return false and print an error if the file can't be read, or if any
+// count, size, or region number in it is out of range.
+bool readMapFile(const std::string &filename, std::vector<GeneratedMap> &maps);
+
+#endif
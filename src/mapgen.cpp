@@ -0,0 +1,139 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "ThreadPool.h"
+#include "map_file.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// Headless batch map generator.  Map i is built from seed S+i, so the output
+// file is identical no matter how many threads are used.  With --verify, the
+// file is read back afterward and each map compared to what was written.
+//
+// Usage: mapgen [--maps N] [--seed S] [--threads N] [--width N] [--height N]
+//               [--out FILE] [--verify]
+
+int main(int argc, char **argv)
+{
+    int numMaps = 100;
+    unsigned int baseSeed = 1;
+    int numThreads = 0;
+    int width = 1280;
+    int height = 768;
+    const char *outFile = "maps.bin";
+    bool isVerifying = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--verify") == 0) {
+            isVerifying = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        const auto opt = argv[i];
+        const auto arg = argv[++i];
+        const auto value = atoi(arg);
+        if (strcmp(opt, "--maps") == 0) {
+            numMaps = value;
+        }
+        else if (strcmp(opt, "--seed") == 0) {
+            baseSeed = strtoul(arg, nullptr, 10);
+        }
+        else if (strcmp(opt, "--threads") == 0) {
+            numThreads = value;
+        }
+        else if (strcmp(opt, "--width") == 0) {
+            width = value;
+        }
+        else if (strcmp(opt, "--height") == 0) {
+            height = value;
+        }
+        else if (strcmp(opt, "--out") == 0) {
+            outFile = arg;
+        }
+        else {
+            std::cerr << "Unknown option " << opt << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (numMaps <= 0 || width <= 0 || height <= 0) {
+        std::cerr << "Maps and map size must be positive." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    ThreadPool pool{numThreads};
+    std::vector<std::vector<unsigned char>> records(numMaps);
+
+    // Each map is encoded into its own buffer and written out in seed order
+    // afterward, so thread scheduling can't change the file.
+    const auto start = std::chrono::steady_clock::now();
+    pool.parallelFor(numMaps, [&] (int i) {
+        appendMapRecord(records[i], generateMap(width, height, baseSeed + i));
+    });
+    const auto stop = std::chrono::steady_clock::now();
+    const double seconds =
+        std::chrono::duration_cast<std::chrono::duration<double>>(stop - start)
+        .count();
+
+    std::vector<unsigned char> header;
+    appendMapHeader(header, numMaps);
+    std::ofstream out{outFile, std::ios::binary};
+    out.write(reinterpret_cast<const char *>(header.data()), header.size());
+    std::size_t bytes = header.size();
+    for (const auto &rec : records) {
+        out.write(reinterpret_cast<const char *>(rec.data()), rec.size());
+        bytes += rec.size();
+    }
+    out.close();
+    if (!out) {
+        std::cerr << "Error writing " << outFile << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Threads: " << pool.size()
+        << "\nMaps: " << numMaps
+        << "\nSeconds: " << seconds
+        << "\nMaps/sec: " << numMaps / seconds
+        << "\nBytes written: " << bytes << '\n';
+
+    if (isVerifying) {
+        // Encoding what was read must give back exactly what was written.
+        std::vector<GeneratedMap> maps;
+        if (!readMapFile(outFile, maps)) {
+            return EXIT_FAILURE;
+        }
+        if (static_cast<int>(maps.size()) != numMaps) {
+            std::cerr << outFile << " has " << maps.size() << " maps, expected "
+                << numMaps << std::endl;
+            return EXIT_FAILURE;
+        }
+        for (int i = 0; i < numMaps; ++i) {
+            std::vector<unsigned char> rec;
+            appendMapRecord(rec, maps[i]);
+            if (rec != records[i]) {
+                std::cerr << "Map " << i << " didn't read back the same"
+                    << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        std::cout << "Verified: " << numMaps << " maps\n";
+    }
+
+    return EXIT_SUCCESS;
+}
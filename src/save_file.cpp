@@ -0,0 +1,250 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "save_file.h"
+#include "alloc_counter.h"
+#include "byte_io.h"
+#include "boost/filesystem.hpp"
+#include "boost/interprocess/file_mapping.hpp"
+#include "boost/interprocess/mapped_region.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    const char magic[4] = {'I', 'S', 'A', 'V'};
+    const unsigned int fileVersion = 1;
+
+    // Later versions can add fields to the end of the header.  Readers skip
+    // whatever they don't know about.
+    const unsigned int headerSize = 80;
+    const unsigned int entitySize = 16;
+}
+
+std::vector<unsigned char> encodeSave(const SaveInfo &info,
+                                      const InfluenceState &state)
+{
+    const auto numRegions = state.owners.size();
+    const auto numEntities = state.entities.size();
+    std::vector<unsigned char> buf;
+    buf.reserve(headerSize + numEntities * entitySize +
+                state.influence.size() * 4 + numRegions * 4);
+
+    for (auto c : magic) {
+        buf.push_back(c);
+    }
+    putU32(buf, fileVersion);
+    putU32(buf, headerSize);
+    putU32(buf, info.mapWidth);
+    putU32(buf, info.mapHeight);
+    putU32(buf, info.shape);
+    putU32(buf, info.seed);
+    putU32(buf, info.numTeams);
+    putU32(buf, info.numLevels);
+    putU32(buf, info.viewer);
+    putU32(buf, info.style);
+    putU32(buf, numRegions);
+    putU32(buf, numEntities);
+    putDouble(buf, info.viewX);
+    putDouble(buf, info.viewY);
+    putDouble(buf, info.zoom);
+    buf.resize(headerSize);  // zero the unused end of the header
+
+    for (const auto &e : state.entities) {
+        putU32(buf, e.id);
+        putU32(buf, e.region);
+        putU32(buf, e.influence);
+        putU32(buf, e.team);
+    }
+    for (auto i : state.influence) {
+        putU32(buf, i);
+    }
+    for (auto owner : state.owners) {
+        putU32(buf, owner);
+    }
+
+    return buf;
+}
+
+bool writeSaveFile(const std::string &filename,
+                   const std::vector<unsigned char> &buf)
+{
+    const auto tmpName = filename + ".tmp";
+    std::ofstream file{tmpName, std::ios::binary};
+    file.write(reinterpret_cast<const char *>(buf.data()), buf.size());
+    file.close();
+    if (!file) {
+        std::cerr << "Error writing " << tmpName << std::endl;
+        return false;
+    }
+
+    boost::system::error_code ec;
+    boost::filesystem::rename(tmpName, filename, ec);
+    if (ec) {
+        std::cerr << "Error renaming " << tmpName << " to " << filename
+            << ": " << ec.message() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool loadSaveFile(const std::string &filename, SaveInfo &info,
+                  InfluenceState &state)
+{
+    namespace bip = boost::interprocess;
+
+    // Mapping the file lets the OS page it in directly instead of copying it
+    // through a stream buffer first.
+    bip::mapped_region region;
+    try {
+        bip::file_mapping file{filename.c_str(), bip::read_only};
+        bip::mapped_region(file, bip::read_only).swap(region);
+    }
+    catch (bip::interprocess_exception &e) {
+        std::cerr << "Error opening " << filename << ": " << e.what()
+            << std::endl;
+        return false;
+    }
+
+    const auto begin = static_cast<const unsigned char *>(region.get_address());
+    const auto size = region.get_size();
+    if (size < headerSize ||
+        !std::equal(std::begin(magic), std::end(magic), begin))
+    {
+        std::cerr << filename << " is not a save file" << std::endl;
+        return false;
+    }
+
+    ByteReader in{begin, size};
+    in.skip(sizeof(magic));
+    const auto version = in.u32();
+    const auto dataStart = in.u32();
+    if (version > fileVersion || dataStart < headerSize) {
+        std::cerr << filename << " has unsupported version " << version
+            << std::endl;
+        return false;
+    }
+
+    info.mapWidth = in.i32();
+    info.mapHeight = in.i32();
+    info.shape = in.i32();
+    info.seed = in.u32();
+    info.numTeams = in.i32();
+    info.numLevels = in.i32();
+    info.viewer = in.i32();
+    info.style = in.i32();
+    const auto numRegions = in.u32();
+    const auto numEntities = in.u32();
+    info.viewX = in.f64();
+    info.viewY = in.f64();
+    info.zoom = in.f64();
+
+    // Work in 64 bits so huge counts in a corrupt file can't wrap around.
+    const auto numInfluence =
+        static_cast<unsigned long long>(numRegions) * info.numTeams;
+    const auto needed = dataStart +
+        static_cast<unsigned long long>(numEntities) * entitySize +
+        numInfluence * 4 + static_cast<unsigned long long>(numRegions) * 4;
+    if (info.numTeams < 0 || needed > size) {
+        std::cerr << filename << " is truncated or corrupt" << std::endl;
+        return false;
+    }
+
+    in.seek(dataStart);
+    state.entities.resize(numEntities);
+    for (auto &e : state.entities) {
+        e.id = in.i32();
+        e.region = in.i32();
+        e.influence = in.i32();
+        e.team = in.i32();
+    }
+    state.influence.resize(numInfluence);
+    in.i32s(state.influence.data(), numInfluence);
+    state.owners.resize(numRegions);
+    in.i32s(state.owners.data(), numRegions);
+
+    return true;
+}
+
+
+SaveWriter::SaveWriter()
+    : mutex_{},
+    hasWork_{},
+    allDone_{},
+    pending_{},
+    hasPending_{false},
+    isWriting_{false},
+    isStopping_{false},
+    thread_{[this] { run(); }}
+{
+}
+
+SaveWriter::~SaveWriter()
+{
+    // Finish any save still waiting, it might be the last checkpoint.
+    {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        isStopping_ = true;
+    }
+    hasWork_.notify_one();
+    thread_.join();
+}
+
+void SaveWriter::save(const std::string &filename, const SaveInfo &info,
+                      std::shared_ptr<const InfluenceState> state)
+{
+    {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        pending_ = Job{filename, info, std::move(state)};
+        hasPending_ = true;
+    }
+    hasWork_.notify_one();
+}
+
+void SaveWriter::wait()
+{
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    while (hasPending_ || isWriting_) {
+        allDone_.wait(lock);
+    }
+}
+
+void SaveWriter::run()
+{
+    // Saves run alongside the frame loop, which checks it doesn't allocate.
+    ignoreAllocsOnThisThread();
+
+    for (;;) {
+        Job job;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex_);
+            while (!hasPending_ && !isStopping_) {
+                hasWork_.wait(lock);
+            }
+            if (!hasPending_) {
+                return;
+            }
+            job = std::move(pending_);
+            hasPending_ = false;
+            isWriting_ = true;
+        }
+
+        writeSaveFile(job.filename, encodeSave(job.info, *job.state));
+
+        {
+            boost::lock_guard<boost::mutex> lock(mutex_);
+            isWriting_ = false;
+        }
+        allDone_.notify_all();
+    }
+}
@@ -0,0 +1,97 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef SAVE_FILE_H
+#define SAVE_FILE_H
+
+#include "InfluenceState.h"
+#include "boost/thread.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+// What it takes to rebuild a map and put the view back where it was, saved
+// alongside the influence state.  Stored as plain numbers so saving doesn't
+// depend on how the map is drawn.
+struct SaveInfo
+{
+    int mapWidth;
+    int mapHeight;
+    int shape;
+    unsigned int seed;
+    int numTeams;
+    int numLevels;
+    int viewer;
+    int style;
+    double viewX;
+    double viewY;
+    double zoom;
+};
+
+// Save files are a fixed-size header followed by the entities, every team's
+// influence over every region, and the owner of every region, each as a flat
+// array of 32-bit little-endian integers.  Nothing needs parsing beyond the
+// header, so loading is little more than copying the arrays out.
+std::vector<unsigned char> encodeSave(const SaveInfo &info,
+                                      const InfluenceState &state);
+
+// Write to a temporary file and rename it over the old one, so a crash in the
+// middle of a save never leaves a truncated file behind.
+bool writeSaveFile(const std::string &filename,
+                   const std::vector<unsigned char> &buf);
+
+// Memory-map a save file and decode it.  Returns false and prints an error if
+// the file is missing, truncated, or from a newer version.
+bool loadSaveFile(const std::string &filename, SaveInfo &info,
+                  InfluenceState &state);
+
+
+// Encodes and writes save files on a background thread, from state that
+// can't change underneath it, so saving never holds up a frame.  If saves
+// are requested faster than they can be written, only the newest waiting one
+// is kept.
+class SaveWriter
+{
+public:
+    SaveWriter();
+    ~SaveWriter();
+
+    SaveWriter(const SaveWriter &) = delete;
+    SaveWriter & operator=(const SaveWriter &) = delete;
+
+    void save(const std::string &filename, const SaveInfo &info,
+              std::shared_ptr<const InfluenceState> state);
+
+    // Block until every save requested so far has been written.
+    void wait();
+
+private:
+    struct Job
+    {
+        std::string filename;
+        SaveInfo info;
+        std::shared_ptr<const InfluenceState> state;
+    };
+
+    void run();
+
+    boost::mutex mutex_;
+    boost::condition_variable hasWork_;
+    boost::condition_variable allDone_;
+    Job pending_;
+    bool hasPending_;
+    bool isWriting_;
+    bool isStopping_;
+    boost::thread thread_;  // last so everything it uses exists first
+};
+
+#endif
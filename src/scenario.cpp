@@ -0,0 +1,528 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "scenario.h"
+#include "byte_io.h"
+#include "boost/filesystem.hpp"
+#include "rapidjson/reader.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <utility>
+
+namespace
+{
+    // Same order as MapShape.
+    const char *shapeNames[] = {"grid", "hex", "voronoi"};
+
+    const int defaultTeams = 2;
+    const int defaultInfluence = 8;
+
+    const char cacheMagic[4] = {'I', 'S', 'C', 'N'};
+    const unsigned int cacheVersion = 1;
+
+
+    // Builds a Scenario from parser events.  Object keys arrive as strings
+    // too, so each level of nesting remembers whether it expects a key or a
+    // value next.  Handlers can't stop the parse, so the first error is
+    // recorded and everything after it ignored.
+    class ScenarioHandler : public rapidjson::BaseReaderHandler<>
+    {
+    public:
+        explicit ScenarioHandler(Scenario &scenario);
+
+        void Null();
+        void Bool(bool b);
+        void Int(int i);
+        void Uint(unsigned u);
+        void Int64(int64_t i);
+        void Uint64(uint64_t u);
+        void Double(double d);
+        void String(const char *str, rapidjson::SizeType length, bool copy);
+        void StartObject();
+        void EndObject(rapidjson::SizeType memberCount);
+        void StartArray();
+        void EndArray(rapidjson::SizeType elementCount);
+
+        const std::string & error() const;
+
+    private:
+        enum class Context {ROOT, MAP, ENTITY_LIST, ENTITY, OTHER};
+
+        struct Level
+        {
+            Context context;
+            bool isObject;
+            bool isKeyNext;
+        };
+
+        // Where the next value goes, or OTHER if nobody wants it.
+        Context valueContext() const;
+
+        // A scalar value has been consumed; the next string is a key again.
+        void endValue();
+
+        void setInt(long long value);
+        void setString(const std::string &str);
+        void setBool(bool b);
+        void fail(const std::string &msg);
+
+        void addEntity();
+
+        Scenario &scn_;
+        std::vector<Level> stack_;
+        std::string key_;
+        ScenarioEntity entity_;
+        bool hasId_;
+        std::string image_;
+        bool isFlag_;
+        std::map<std::pair<std::string, bool>, int> spriteIndex_;
+        std::string error_;
+    };
+
+    ScenarioHandler::ScenarioHandler(Scenario &scenario)
+        : scn_(scenario),
+        stack_{},
+        key_{},
+        entity_{},
+        hasId_{false},
+        image_{},
+        isFlag_{false},
+        spriteIndex_{},
+        error_{}
+    {
+        scn_.shape = -1;
+        scn_.hasSeed = false;
+        scn_.seed = 0;
+        scn_.numTeams = defaultTeams;
+        scn_.sprites.clear();
+        scn_.entities.clear();
+    }
+
+    void ScenarioHandler::Null()
+    {
+        endValue();
+    }
+
+    void ScenarioHandler::Bool(bool b)
+    {
+        setBool(b);
+        endValue();
+    }
+
+    void ScenarioHandler::Int(int i)
+    {
+        setInt(i);
+        endValue();
+    }
+
+    void ScenarioHandler::Uint(unsigned u)
+    {
+        setInt(u);
+        endValue();
+    }
+
+    void ScenarioHandler::Int64(int64_t i)
+    {
+        setInt(i);
+        endValue();
+    }
+
+    void ScenarioHandler::Uint64(uint64_t u)
+    {
+        setInt(std::min<uint64_t>(u, UINT32_MAX + 1ull));
+        endValue();
+    }
+
+    void ScenarioHandler::Double(double)
+    {
+        if (valueContext() != Context::OTHER) {
+            fail("expected an integer for \"" + key_ + "\"");
+        }
+        endValue();
+    }
+
+    void ScenarioHandler::String(const char *str, rapidjson::SizeType length,
+                                 bool)
+    {
+        if (!stack_.empty() && stack_.back().isObject &&
+            stack_.back().isKeyNext)
+        {
+            key_.assign(str, length);
+            stack_.back().isKeyNext = false;
+            return;
+        }
+
+        setString(std::string(str, length));
+        endValue();
+    }
+
+    void ScenarioHandler::StartObject()
+    {
+        auto context = Context::OTHER;
+        if (stack_.empty()) {
+            context = Context::ROOT;
+        }
+        else {
+            const auto parent = valueContext();
+            if (parent == Context::ROOT && key_ == "map") {
+                context = Context::MAP;
+            }
+            else if (stack_.back().context == Context::ENTITY_LIST) {
+                context = Context::ENTITY;
+                entity_ = ScenarioEntity{{0, -1, defaultInfluence, noTeam}, -1};
+                hasId_ = false;
+                image_.clear();
+                isFlag_ = false;
+            }
+            endValue();
+        }
+        stack_.push_back(Level{context, true, true});
+    }
+
+    void ScenarioHandler::EndObject(rapidjson::SizeType)
+    {
+        if (stack_.back().context == Context::ENTITY) {
+            addEntity();
+        }
+        stack_.pop_back();
+    }
+
+    void ScenarioHandler::StartArray()
+    {
+        auto context = Context::OTHER;
+        if (valueContext() == Context::ROOT && key_ == "entities") {
+            context = Context::ENTITY_LIST;
+        }
+        if (!stack_.empty()) {
+            endValue();
+        }
+        stack_.push_back(Level{context, false, false});
+    }
+
+    void ScenarioHandler::EndArray(rapidjson::SizeType)
+    {
+        stack_.pop_back();
+    }
+
+    const std::string & ScenarioHandler::error() const
+    {
+        return error_;
+    }
+
+    ScenarioHandler::Context ScenarioHandler::valueContext() const
+    {
+        if (stack_.empty() || !stack_.back().isObject) {
+            return Context::OTHER;
+        }
+        return stack_.back().context;
+    }
+
+    void ScenarioHandler::endValue()
+    {
+        if (!stack_.empty() && stack_.back().isObject) {
+            stack_.back().isKeyNext = true;
+        }
+    }
+
+    void ScenarioHandler::setInt(long long value)
+    {
+        // Seeds are unsigned, everything else is an int.
+        const auto context = valueContext();
+        const bool isSeed = (context == Context::MAP && key_ == "seed");
+        const long long maxValue = isSeed ? UINT32_MAX : INT32_MAX;
+        const long long minValue = isSeed ? 0 : INT32_MIN;
+        if (value < minValue || value > maxValue) {
+            if (context != Context::OTHER) {
+                fail("\"" + key_ + "\" is out of range");
+            }
+            return;
+        }
+
+        if (context == Context::ROOT && key_ == "teams") {
+            if (value < 1) {
+                fail("a scenario needs at least one team");
+            }
+            scn_.numTeams = value;
+        }
+        else if (isSeed) {
+            scn_.hasSeed = true;
+            scn_.seed = static_cast<unsigned int>(value);
+        }
+        else if (context == Context::ENTITY) {
+            if (key_ == "id") {
+                entity_.entity.id = value;
+                hasId_ = true;
+            }
+            else if (key_ == "region") {
+                entity_.entity.region = value;
+            }
+            else if (key_ == "influence") {
+                entity_.entity.influence = value;
+            }
+            else if (key_ == "team") {
+                entity_.entity.team = value;
+            }
+        }
+    }
+
+    void ScenarioHandler::setString(const std::string &str)
+    {
+        const auto context = valueContext();
+        if (context == Context::MAP && key_ == "shape") {
+            const auto iter = std::find(std::begin(shapeNames),
+                                        std::end(shapeNames), str);
+            if (iter == std::end(shapeNames)) {
+                fail("unknown map shape \"" + str + "\"");
+                return;
+            }
+            scn_.shape = iter - std::begin(shapeNames);
+        }
+        else if (context == Context::ENTITY && key_ == "image") {
+            image_ = str;
+        }
+    }
+
+    void ScenarioHandler::setBool(bool b)
+    {
+        if (valueContext() == Context::ENTITY && key_ == "flag") {
+            isFlag_ = b;
+        }
+    }
+
+    void ScenarioHandler::fail(const std::string &msg)
+    {
+        if (error_.empty()) {
+            error_ = msg;
+        }
+    }
+
+    void ScenarioHandler::addEntity()
+    {
+        if (!hasId_ || entity_.entity.region < 0) {
+            fail("every entity needs an id and a region");
+            return;
+        }
+
+        if (!image_.empty()) {
+            const auto key = std::make_pair(image_, isFlag_);
+            auto iter = spriteIndex_.find(key);
+            if (iter == std::end(spriteIndex_)) {
+                iter = spriteIndex_.insert(
+                    std::make_pair(key, scn_.sprites.size())).first;
+                scn_.sprites.push_back(ScenarioSprite{image_, isFlag_});
+            }
+            entity_.sprite = iter->second;
+        }
+        scn_.entities.push_back(entity_);
+    }
+
+
+    std::string cacheName(const std::string &filename)
+    {
+        return filename + ".cache";
+    }
+
+    bool readFile(const std::string &filename,
+                  std::vector<unsigned char> &buf)
+    {
+        std::ifstream file{filename, std::ios::binary};
+        if (!file) {
+            return false;
+        }
+        buf.assign(std::istreambuf_iterator<char>(file),
+                   std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    // Cache files identify their source by size and modification time.
+    struct SourceStamp
+    {
+        unsigned long long size;
+        unsigned long long mtime;
+    };
+
+    bool getStamp(const std::string &filename, SourceStamp &stamp)
+    {
+        boost::system::error_code ec;
+        stamp.size = boost::filesystem::file_size(filename, ec);
+        if (ec) {
+            return false;
+        }
+        stamp.mtime = boost::filesystem::last_write_time(filename, ec);
+        return !ec;
+    }
+
+    bool writeCache(const std::string &filename, const SourceStamp &stamp,
+                    const Scenario &scn)
+    {
+        std::vector<unsigned char> buf(std::begin(cacheMagic),
+                                       std::end(cacheMagic));
+        putU32(buf, cacheVersion);
+        putU64(buf, stamp.size);
+        putU64(buf, stamp.mtime);
+        putU32(buf, scn.shape);
+        putU32(buf, scn.hasSeed);
+        putU32(buf, scn.seed);
+        putU32(buf, scn.numTeams);
+
+        putU32(buf, scn.sprites.size());
+        for (const auto &s : scn.sprites) {
+            putU32(buf, s.image.size());
+            buf.insert(end(buf), begin(s.image), end(s.image));
+            putU32(buf, s.isFlag);
+        }
+
+        putU32(buf, scn.entities.size());
+        for (const auto &e : scn.entities) {
+            putU32(buf, e.entity.id);
+            putU32(buf, e.entity.region);
+            putU32(buf, e.entity.influence);
+            putU32(buf, e.entity.team);
+            putU32(buf, e.sprite);
+        }
+
+        // A cache cut short by a crash could still carry a matching stamp,
+        // so write it under another name and swap it in when it's complete.
+        const auto tmpName = filename + ".tmp";
+        std::ofstream file{tmpName, std::ios::binary};
+        file.write(reinterpret_cast<const char *>(buf.data()), buf.size());
+        file.close();
+        if (!file) {
+            return false;
+        }
+
+        boost::system::error_code ec;
+        boost::filesystem::rename(tmpName, filename, ec);
+        return !ec;
+    }
+
+    // Return false if the cache is missing, out of date, or unreadable, or if
+    // it holds anything parsing the JSON would have rejected.
+    bool readCache(const std::string &filename, const SourceStamp &stamp,
+                   Scenario &scn)
+    {
+        std::vector<unsigned char> buf;
+        if (!readFile(filename, buf) || buf.size() < sizeof(cacheMagic) ||
+            !std::equal(std::begin(cacheMagic), std::end(cacheMagic),
+                        begin(buf)))
+        {
+            return false;
+        }
+
+        ByteReader in{buf};
+        in.str(sizeof(cacheMagic));
+        if (in.u32() != cacheVersion || in.u64() != stamp.size ||
+            in.u64() != stamp.mtime)
+        {
+            return false;
+        }
+
+        scn.shape = in.u32();
+        scn.hasSeed = in.u32() != 0;
+        scn.seed = in.u32();
+        scn.numTeams = in.u32();
+
+        const auto numSprites = in.u32();
+        scn.sprites.clear();
+        for (unsigned int i = 0; i < numSprites && in.ok(); ++i) {
+            ScenarioSprite s;
+            s.image = in.str(in.u32());
+            s.isFlag = in.u32() != 0;
+            scn.sprites.push_back(std::move(s));
+        }
+
+        // Guard against a corrupt count before reserving space for it.
+        const auto numEntities = in.u32();
+        if (!in.ok() || numEntities > buf.size() / 20) {
+            return false;
+        }
+        scn.entities.resize(numEntities);
+        for (auto &e : scn.entities) {
+            e.entity.id = in.u32();
+            e.entity.region = in.u32();
+            e.entity.influence = in.u32();
+            e.entity.team = in.u32();
+            e.sprite = in.u32();
+        }
+        if (!in.ok() || !in.atEnd()) {
+            return false;
+        }
+
+        const int numShapes = std::end(shapeNames) - std::begin(shapeNames);
+        if (scn.shape < -1 || scn.shape >= numShapes || scn.numTeams < 1) {
+            return false;
+        }
+        const int maxSprite = scn.sprites.size();
+        for (const auto &e : scn.entities) {
+            if (e.entity.region < 0 || e.sprite < -1 || e.sprite >= maxSprite) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+bool parseScenarioJson(const std::string &filename, Scenario &scenario)
+{
+    std::vector<unsigned char> json;
+    if (!readFile(filename, json)) {
+        std::cerr << "Error opening " << filename << std::endl;
+        return false;
+    }
+    json.push_back('\0');  // in-situ parsing needs a terminated string
+
+    ScenarioHandler handler{scenario};
+    rapidjson::Reader reader;
+    rapidjson::InsituStringStream stream{reinterpret_cast<char *>(json.data())};
+    if (!reader.Parse<rapidjson::kParseInsituFlag>(stream, handler)) {
+        std::cerr << filename << ": " << reader.GetParseError()
+            << " at offset " << reader.GetErrorOffset() << std::endl;
+        return false;
+    }
+    if (!handler.error().empty()) {
+        std::cerr << filename << ": " << handler.error() << std::endl;
+        return false;
+    }
+
+    // Keep entities in id order, so adding them to the map only ever appends.
+    std::stable_sort(begin(scenario.entities), end(scenario.entities),
+        [] (const ScenarioEntity &lhs, const ScenarioEntity &rhs) {
+            return lhs.entity.id < rhs.entity.id;
+        });
+    return true;
+}
+
+bool loadScenario(const std::string &filename, Scenario &scenario)
+{
+    SourceStamp stamp;
+    if (!getStamp(filename, stamp)) {
+        std::cerr << "Error opening " << filename << std::endl;
+        return false;
+    }
+
+    const auto cache = cacheName(filename);
+    if (readCache(cache, stamp, scenario)) {
+        return true;
+    }
+
+    if (!parseScenarioJson(filename, scenario)) {
+        return false;
+    }
+    if (!writeCache(cache, stamp, scenario)) {
+        std::cerr << "Warning: couldn't write " << cache << std::endl;
+    }
+    return true;
+}
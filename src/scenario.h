@@ -0,0 +1,70 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include "InfluenceState.h"
+#include <string>
+#include <vector>
+
+// Scenario files are JSON:
+//
+//  {
+//      "map": {"shape": "voronoi", "seed": 42},
+//      "teams": 2,
+//      "entities": [
+//          {"id": 1, "region": 1, "influence": 8, "team": 0,
+//           "image": "cavalier.png"},
+//          {"id": 3, "region": 24, "influence": 0, "image": "flag.png",
+//           "flag": true},
+//          ...
+//      ]
+//  }
+//
+// Everything is optional except each entity's id and region.  Entities with
+// no team belong to nobody.  Flag images are recolored from green to the
+// team colors.  Unknown keys are ignored.
+
+struct ScenarioSprite
+{
+    std::string image;
+    bool isFlag;
+};
+
+struct ScenarioEntity
+{
+    MapEntity entity;
+    int sprite;  // index into Scenario::sprites, or -1 for none
+};
+
+struct Scenario
+{
+    int shape;  // MapShape value, or -1 if the scenario doesn't say
+    bool hasSeed;
+    unsigned int seed;
+    int numTeams;
+    std::vector<ScenarioSprite> sprites;  // each distinct image only once
+    std::vector<ScenarioEntity> entities;
+};
+
+// Parse a scenario from JSON.  The file is read into memory and parsed in
+// place, one token at a time, without building a document tree.  Returns
+// false and prints an error on failure.
+bool parseScenarioJson(const std::string &filename, Scenario &scenario);
+
+// Compiled scenarios are cached next to the source as FILE.cache, tagged with
+// the source's size and modification time.  Loading uses the cache if it
+// matches the source, and otherwise parses the JSON and rewrites the cache.
+bool loadScenario(const std::string &filename, Scenario &scenario);
+
+#endif
@@ -199,7 +199,27 @@ SdlClipRect::SdlClipRect(SDL_Renderer *renderer, const SDL_Rect &clip)
 
 SdlClipRect::~SdlClipRect()
 {
-    SDL_RenderSetClipRect(ren_, &orig_);
+    // An empty rectangle means clipping was off.
+    if (SDL_RectEmpty(&orig_)) {
+        SDL_RenderSetClipRect(ren_, nullptr);
+    }
+    else {
+        SDL_RenderSetClipRect(ren_, &orig_);
+    }
+}
+
+SdlRenderTarget::SdlRenderTarget(SDL_Renderer *renderer, SDL_Texture *target)
+    : ren_{renderer},
+    orig_{SDL_GetRenderTarget(renderer)}
+{
+    if (SDL_SetRenderTarget(ren_, target) < 0) {
+        std::cerr << "Error setting render target: " << SDL_GetError();
+    }
+}
+
+SdlRenderTarget::~SdlRenderTarget()
+{
+    SDL_SetRenderTarget(ren_, orig_);
 }
 
 SdlDrawColor::SdlDrawColor(SDL_Renderer *ren, Uint8 r, Uint8 g, Uint8 b)
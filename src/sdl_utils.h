@@ -24,6 +24,7 @@ const SDL_Color GREY = {192, 192, 192, SDL_ALPHA_OPAQUE};
 const SDL_Color BORDER_FG = {96, 100, 96, SDL_ALPHA_OPAQUE};
 const SDL_Color BORDER_BG = {32, 32, 24, SDL_ALPHA_OPAQUE};
 const SDL_Color BLACK = {0, 0, 0, SDL_ALPHA_OPAQUE};
+const SDL_Color FOG = {64, 64, 64, SDL_ALPHA_OPAQUE};
 
 bool operator==(const SDL_Color &lhs, const SDL_Color &rhs);
 bool operator<(const SDL_Color &lhs, const SDL_Color &rhs);
@@ -67,6 +68,17 @@ private:
     SDL_Rect orig_;
 };
 
+// RAII guard for redirecting drawing to a texture and back.
+class SdlRenderTarget
+{
+public:
+    SdlRenderTarget(SDL_Renderer *renderer, SDL_Texture *target);
+    ~SdlRenderTarget();
+private:
+    SDL_Renderer *ren_;
+    SDL_Texture *orig_;
+};
+
 // RAII guard for setting/restoring the drawing color.
 class SdlDrawColor
 {
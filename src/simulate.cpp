@@ -0,0 +1,126 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#include "Match.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Headless batch runner.  Plays out many independent matches in parallel
+// and reports aggregate throughput.
+//
+// Usage: simulate [--matches N] [--turns N] [--threads N] [--seed N]
+//                 [--cols N] [--rows N] [--teams N] [--entities N]
+//                 [--ai N]
+//
+// With --ai N, the first N teams use the move planner instead of wandering.
+
+int main(int argc, char **argv)
+{
+    MatchConfig config = {8, 4, 2, 4, 8, 100, 0};
+    int numMatches = 1000;
+    int numThreads = 0;
+    unsigned int baseSeed = 1;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const auto value = atoi(argv[i + 1]);
+        if (strcmp(argv[i], "--matches") == 0) {
+            numMatches = value;
+        }
+        else if (strcmp(argv[i], "--turns") == 0) {
+            config.turns = value;
+        }
+        else if (strcmp(argv[i], "--threads") == 0) {
+            numThreads = value;
+        }
+        else if (strcmp(argv[i], "--seed") == 0) {
+            baseSeed = value;
+        }
+        else if (strcmp(argv[i], "--cols") == 0) {
+            config.cols = value;
+        }
+        else if (strcmp(argv[i], "--rows") == 0) {
+            config.rows = value;
+        }
+        else if (strcmp(argv[i], "--teams") == 0) {
+            config.numTeams = value;
+        }
+        else if (strcmp(argv[i], "--entities") == 0) {
+            config.entitiesPerTeam = value;
+        }
+        else if (strcmp(argv[i], "--ai") == 0) {
+            config.aiTeams = value;
+        }
+        else {
+            std::cerr << "Unknown option " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (numMatches <= 0 || config.cols <= 0 || config.rows <= 0 ||
+        config.numTeams <= 0)
+    {
+        std::cerr << "Matches, map size and teams must be positive."
+            << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    ThreadPool pool{numThreads};
+    std::vector<MatchResult> results(numMatches);
+
+    // Each match writes only to its own slot in 'results'.
+    const auto start = std::chrono::steady_clock::now();
+    pool.parallelFor(numMatches, [&] (int i) {
+        Match match{config, baseSeed + i};
+        while (!match.isDone()) {
+            match.step();
+        }
+        results[i] = match.result();
+    });
+    const auto stop = std::chrono::steady_clock::now();
+    const double seconds =
+        std::chrono::duration_cast<std::chrono::duration<double>>(stop - start)
+        .count();
+
+    long long updates = 0;
+    std::vector<int> wins(config.numTeams, 0);
+    int draws = 0;
+    for (const auto &res : results) {
+        updates += res.updates;
+
+        // Same rule as owning a region: a team wins only with strictly more
+        // regions than every other team, and nobody wins with none.
+        const auto winner = ownerFromInfluence(res.regionsOwned.data(),
+                                               config.numTeams);
+        if (winner >= 0) {
+            ++wins[winner];
+        }
+        else {
+            ++draws;
+        }
+    }
+
+    std::cout << "Threads: " << pool.size()
+        << "\nMatches: " << numMatches
+        << "\nUpdates: " << updates
+        << "\nSeconds: " << seconds
+        << "\nMatches/sec: " << numMatches / seconds
+        << "\nUpdates/sec: " << updates / seconds << '\n';
+    for (int t = 0; t < config.numTeams; ++t) {
+        std::cout << "Team " << t << " wins: " << wins[t] << '\n';
+    }
+    std::cout << "Draws: " << draws << '\n';
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,21 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef TEAM_H
+#define TEAM_H
+
+// Teams are numbered from 0 and used as indexes into per-team data.  How many
+// there are is up to each map.  Entities that belong to nobody are on noTeam
+// and exert no influence.
+const int noTeam = -1;
+
+#endif
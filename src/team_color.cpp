@@ -13,18 +13,19 @@
 #include "team_color.h"
 #include <algorithm>
 #include <cassert>
-
-// Reference color for each team.  The other 18 shades are offset from
-// this, 14 darker and 4 lighter.
-const std::vector<SDL_Color> teamColors = {
-    {0x2E, 0x41, 0x9B, SDL_ALPHA_OPAQUE}, // blue
-    {0xFF, 0, 0, SDL_ALPHA_OPAQUE},       // red
-    {0x5A, 0x5A, 0x5A, SDL_ALPHA_OPAQUE}  // grey (no team)
-};
+#include <cmath>
+#include <iostream>
+#include <map>
 
 namespace
 {
-    using TeamColorMatrix = std::vector<std::vector<SDL_Color>>;
+    // The other 18 shades of each team's palette are offset from its
+    // reference color, 14 darker and 4 lighter.
+    const SDL_Color noTeamColor = {0x5A, 0x5A, 0x5A, SDL_ALPHA_OPAQUE};
+    const std::vector<SDL_Color> fixedTeamColors = {
+        {0x2E, 0x41, 0x9B, SDL_ALPHA_OPAQUE}, // blue
+        {0xFF, 0, 0, SDL_ALPHA_OPAQUE}        // red
+    };
 
     // Magenta color palette to be replaced by team colors.
     const std::vector<SDL_Color> baseColors = {
@@ -93,26 +94,63 @@ namespace
         return colors;
     }
 
-    TeamColorMatrix initTeamColors()
+    SDL_Color colorFromHsv(double h, double s, double v)
     {
-        TeamColorMatrix ret;
-        for (const auto &color : teamColors) {
-            ret.emplace_back(makeTeamColors(color));
+        const auto sector = static_cast<int>(h * 6) % 6;
+        const auto f = h * 6 - std::floor(h * 6);
+        const auto p = v * (1 - s);
+        const auto q = v * (1 - f * s);
+        const auto t = v * (1 - (1 - f) * s);
+
+        double r = v, g = t, b = p;
+        switch (sector) {
+            case 1: r = q; g = v; b = p; break;
+            case 2: r = p; g = v; b = t; break;
+            case 3: r = p; g = q; b = v; break;
+            case 4: r = t; g = p; b = v; break;
+            case 5: r = v; g = p; b = q; break;
         }
-        return ret;
+        return {static_cast<Uint8>(r * 255),
+                static_cast<Uint8>(g * 255),
+                static_cast<Uint8>(b * 255),
+                SDL_ALPHA_OPAQUE};
     }
 
-    const TeamColorMatrix allShades = initTeamColors();
+    // All 19 shades for a team, generated the first time they're needed.
+    // Index 0 is noTeam.  Only call this from the main thread.
+    const std::vector<SDL_Color> & teamShades(int team)
+    {
+        static std::vector<std::vector<SDL_Color>> shades;
+        const int index = team - noTeam;
+        assert(index >= 0);
+        while (static_cast<int>(shades.size()) <= index) {
+            const int t = static_cast<int>(shades.size()) + noTeam;
+            shades.push_back(makeTeamColors(teamColor(t)));
+        }
+        return shades[index];
+    }
 
-    SDL_Color translateTeamColor(const SDL_Color &orig, Team t)
+    // Return the index of a color in the magenta palette, ignoring alpha, or
+    // -1 if it's not one of the reference shades.
+    int findBaseColor(const SDL_Color &orig)
     {
         auto color = orig;
         color.a = SDL_ALPHA_OPAQUE;
         auto iter = lower_bound(std::begin(baseColors), std::end(baseColors),
                                 color);
         if (iter != std::end(baseColors) && *iter == color) {
-            const auto index = distance(std::begin(baseColors), iter);
-            color = allShades[static_cast<int>(t)][index];
+            return distance(std::begin(baseColors), iter);
+        }
+
+        return -1;
+    }
+
+    SDL_Color translateTeamColor(const SDL_Color &orig, int team)
+    {
+        auto color = orig;
+        const auto index = findBaseColor(orig);
+        if (index >= 0) {
+            color = teamShades(team)[index];
         }
 
         color.a = orig.a;
@@ -130,37 +168,202 @@ namespace
         magenta.a = orig.a;
         return magenta;
     }
+
+    // Write every pixel of 'src' to 'dest' after passing it through
+    // 'translate'.  The two can be the same surface.
+    template <typename Func>
+    void recolor(const SdlSurface &src, SdlSurface &dest, Func translate)
+    {
+        assert(src->w == dest->w && src->h == dest->h);
+        SdlLockSurface guard{dest};
+
+        const auto bpp = dest->format->BytesPerPixel;
+        for (int y = 0; y < dest->h; ++y) {
+            auto from = static_cast<const Uint8 *>(src->pixels) +
+                y * src->pitch;
+            auto to = static_cast<Uint8 *>(dest->pixels) + y * dest->pitch;
+            for (int x = 0; x < dest->w; ++x, from += bpp, to += bpp) {
+                sdlSetPixel(dest, to, translate(sdlGetPixel(src, from)));
+            }
+        }
+    }
 }
 
 
-SdlSurface applyTeamColor(const SdlSurface &src, Team team)
+SDL_Color teamColor(int team)
 {
-    auto img = sdlDeepCopy(src);
-    SdlLockSurface guard{img};
+    if (team < 0) {
+        return noTeamColor;
+    }
+    if (team < static_cast<int>(fixedTeamColors.size())) {
+        return fixedTeamColors[team];
+    }
+
+    // Golden ratio steps around the hue circle never repeat and keep
+    // consecutive teams far apart.  Alternate the brightness too so teams
+    // with nearby hues still differ.
+    const double goldenRatio = 0.618033988749895;
+    const auto hue = std::fmod(0.62 + team * goldenRatio, 1.0);
+    const auto value = (team % 2 == 0) ? 0.95 : 0.7;
+    return colorFromHsv(hue, 0.8, value);
+}
 
-    auto pixel = static_cast<Uint8 *>(img->pixels);
-    const auto bpp = img->format->BytesPerPixel;
-    const auto end = pixel + img->w * img->h * bpp;
-    for (; pixel != end; pixel += bpp) {
-        const auto color = sdlGetPixel(img, pixel);
-        sdlSetPixel(img, pixel, translateTeamColor(color, team));
+SdlSurface applyTeamColor(const SdlSurface &src, int team)
+{
+    auto img = sdlDeepCopy(src);
+    if (img) {
+        recolor(img, img, [team] (const SDL_Color &c) {
+            return translateTeamColor(c, team);
+        });
     }
+    return img;
+}
 
+SdlSurface applyTeamColor(const SdlSurface &src, int team, SurfacePool &pool)
+{
+    auto img = pool.acquire(src->w, src->h, src->format);
+    if (img) {
+        recolor(src, img, [team] (const SDL_Color &c) {
+            return translateTeamColor(c, team);
+        });
+    }
     return img;
 }
 
 SdlSurface applyFlagColor(const SdlSurface &src)
 {
     auto img = sdlDeepCopy(src);
-    SdlLockSurface guard{img};
-
-    auto pixel = static_cast<Uint8 *>(img->pixels);
-    const auto bpp = img->format->BytesPerPixel;
-    const auto end = pixel + img->w * img->h * bpp;
-    for (; pixel != end; pixel += bpp) {
-        const auto color = sdlGetPixel(img, pixel);
-        sdlSetPixel(img, pixel, translateFlagColor(color));
+    if (img) {
+        recolor(img, img, translateFlagColor);
     }
+    return img;
+}
 
+SdlSurface applyFlagColor(const SdlSurface &src, SurfacePool &pool)
+{
+    auto img = pool.acquire(src->w, src->h, src->format);
+    if (img) {
+        recolor(src, img, translateFlagColor);
+    }
     return img;
 }
+
+TeamSprite::TeamSprite()
+    : pixels_{},
+    palette_{},
+    teamSlots_{},
+    teamViews_{}
+{
+}
+
+TeamSprite::TeamSprite(const SdlSurface &src)
+    : TeamSprite{}
+{
+    if (!src) {
+        return;
+    }
+
+    if (!makeIndexed(src)) {
+        // Fall back to recoloring every pixel for each team.
+        pixels_ = src;
+    }
+}
+
+SdlSurface TeamSprite::get(int team) const
+{
+    assert(*this);
+    const auto t = team - noTeam;
+    if (t >= static_cast<int>(teamViews_.size())) {
+        teamViews_.resize(t + 1);
+    }
+    if (teamViews_[t]) {
+        return teamViews_[t];
+    }
+
+    if (pixels_->format->BitsPerPixel != 8) {
+        teamViews_[t] = applyTeamColor(pixels_, team);
+        return teamViews_[t];
+    }
+
+    // New surface header pointing at the shared pixels.  The deleter keeps
+    // the indexed image alive as long as any team's view of it is.
+    auto view = SDL_CreateRGBSurfaceFrom(pixels_->pixels,
+                                         pixels_->w,
+                                         pixels_->h,
+                                         8,
+                                         pixels_->pitch,
+                                         0, 0, 0, 0);
+    if (!view) {
+        std::cerr << "Error creating team sprite: " << SDL_GetError();
+        return {};
+    }
+
+    auto colors = palette_;
+    for (const auto &slot : teamSlots_) {
+        auto &c = colors[slot.first];
+        const auto alpha = c.a;
+        c = teamShades(team)[slot.second];
+        c.a = alpha;
+    }
+    SDL_SetPaletteColors(view->format->palette, colors.data(), 0,
+                         colors.size());
+
+    const auto shared = pixels_;
+    teamViews_[t] = SdlSurface(view, [shared] (SDL_Surface *surf) {
+        SDL_FreeSurface(surf);
+    });
+    return teamViews_[t];
+}
+
+TeamSprite::operator bool() const
+{
+    return static_cast<bool>(pixels_);
+}
+
+bool TeamSprite::makeIndexed(const SdlSurface &src)
+{
+    auto img = make_surface(SDL_CreateRGBSurface(0, src->w, src->h, 8,
+                                                 0, 0, 0, 0));
+    if (!img) {
+        std::cerr << "Error creating indexed sprite: " << SDL_GetError();
+        return false;
+    }
+
+    // Assign a palette entry to each distinct color.  Reference shades are
+    // kept separate per alpha value so antialiased edges stay translucent.
+    std::map<SDL_Color, int> colorIndex;
+    auto srcCopy = src;
+    SdlLockSurface srcGuard{srcCopy};
+    SdlLockSurface imgGuard{img};
+    for (int y = 0; y < src->h; ++y) {
+        auto pixel = static_cast<const Uint8 *>(src->pixels) + y * src->pitch;
+        auto index = static_cast<Uint8 *>(img->pixels) + y * img->pitch;
+        for (int x = 0; x < src->w; ++x, pixel += src->format->BytesPerPixel) {
+            auto color = sdlGetPixel(src, pixel);
+            if (color.a == SDL_ALPHA_TRANSPARENT) {
+                color = {0, 0, 0, SDL_ALPHA_TRANSPARENT};
+            }
+
+            auto iter = colorIndex.find(color);
+            if (iter == std::end(colorIndex)) {
+                if (palette_.size() == 256) {
+                    palette_.clear();
+                    teamSlots_.clear();
+                    return false;
+                }
+
+                const int newIndex = palette_.size();
+                const auto shade = findBaseColor(color);
+                if (shade >= 0 && color.a != SDL_ALPHA_TRANSPARENT) {
+                    teamSlots_.emplace_back(newIndex, shade);
+                }
+                palette_.push_back(color);
+                iter = colorIndex.insert(std::make_pair(color, newIndex)).first;
+            }
+            index[x] = iter->second;
+        }
+    }
+
+    pixels_ = img;
+    return true;
+}
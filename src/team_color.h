@@ -14,20 +14,56 @@
 #define TEAM_COLOR_H
 
 #include "SdlWindow.h"
+#include "SurfacePool.h"
 #include "sdl_utils.h"
+#include "team.h"
+#include <utility>
 #include <vector>
 
 // This is an implementation of the team color algorithm from Battle for
 // Wesnoth.  We reserve a specific palette of 19 shades of magenta as a
 // reference.  Those colors are replaced at runtime with the corresponding
 // color for each team.
-enum class Team {BLUE, RED, NONE};
-extern const std::vector<SDL_Color> teamColors;
+//
+// Return the reference color for any team number, or grey for noTeam.  The
+// first two teams are blue and red; the rest are spread around the color
+// wheel so any number of teams stay distinguishable.
+SDL_Color teamColor(int team);
 
-// Translate the magenta palette to the team color.
-SdlSurface applyTeamColor(const SdlSurface &src, Team team);
+// Translate the magenta palette to the team color.  The pool versions
+// recycle a surface the caller is done with instead of allocating a new one.
+SdlSurface applyTeamColor(const SdlSurface &src, int team);
+SdlSurface applyTeamColor(const SdlSurface &src, int team, SurfacePool &pool);
 
 // Flags are green and need to be translated to magenta first.
 SdlSurface applyFlagColor(const SdlSurface &src);
+SdlSurface applyFlagColor(const SdlSurface &src, SurfacePool &pool);
+
+
+// An image stored once as 8-bit indexed color.  Palette entries matching the
+// magenta reference shades are team slots, so drawing the image for another
+// team only needs a new palette, not another pass over the pixels.
+class TeamSprite
+{
+public:
+    TeamSprite();
+    explicit TeamSprite(const SdlSurface &src);
+
+    // Return a surface in the team's colors.  It shares pixel data with every
+    // other team's copy of this sprite.
+    SdlSurface get(int team) const;
+
+    explicit operator bool() const;
+
+private:
+    // Build the indexed image.  Returns false if the source uses too many
+    // colors to fit in a palette.
+    bool makeIndexed(const SdlSurface &src);
+
+    SdlSurface pixels_;
+    std::vector<SDL_Color> palette_;
+    std::vector<std::pair<int, int>> teamSlots_;  // (palette index, shade)
+    mutable std::vector<SdlSurface> teamViews_;
+};
 
 #endif
@@ -10,67 +10,259 @@
 
     See the COPYING.txt file for more details.
 */
-#include "sdl_utils.h"
+#include "voronoi.h"
+#include <algorithm>
 #include <cmath>
-#include <ctime>
 #include <random>
 
 namespace
 {
-    std::minstd_rand randgen(static_cast<unsigned int>(std::time(nullptr)));
-}
+    // Edges shorter than this are treated as the cells touching at a point,
+    // not sharing a border.
+    const double minEdgeLength = 1e-6;
 
-/* TODO:
-   generate voronoi diagram at the pixel level
-   lots of small regions around the outside edges (water)
-   - use 5% of the width/height on each side?
-   larger regions on the inside (land)
-   any pixel that borders another region gets colored black
-*/
+    // Pick integers in [lo,hi] like std::uniform_int_distribution, except
+    // that the standard leaves its algorithm up to each library.  Doing the
+    // mapping here means a seed gives the same map on every compiler.
+    class RandRange
+    {
+    public:
+        RandRange(int lo, int hi)
+            : lo_{lo},
+            span_(static_cast<unsigned long long>(hi - lo) + 1)
+        {
+        }
+
+        int operator()(std::minstd_rand &gen) const
+        {
+            const auto range = static_cast<unsigned long long>(
+                std::minstd_rand::max() - std::minstd_rand::min()) + 1;
+            const unsigned long long r = gen() - std::minstd_rand::min();
+            return lo_ + static_cast<int>(r * span_ / range);
+        }
+
+    private:
+        int lo_;
+        unsigned long long span_;
+    };
+
+    // Keep the part of a cell on the same side as 'center' of the line
+    // halfway between it and 'other'.  New edges along that line get
+    // 'otherIndex' as their neighbor.
+    void clipCell(VoronoiCell &cell, const MapPoint &other, int otherIndex)
+    {
+        const double nx = other.x - cell.center.x;
+        const double ny = other.y - cell.center.y;
+        const double midX = (cell.center.x + other.x) / 2.0;
+        const double midY = (cell.center.y + other.y) / 2.0;
+        auto side = [&] (const VoronoiVertex &v) {
+            return (v.x - midX) * nx + (v.y - midY) * ny;
+        };
+
+        std::vector<VoronoiVertex> vertices;
+        std::vector<int> neighbors;
+        const int n = cell.vertices.size();
+        for (int i = 0; i < n; ++i) {
+            const auto &a = cell.vertices[i];
+            const auto &b = cell.vertices[(i + 1) % n];
+            const auto sa = side(a);
+            const auto sb = side(b);
+            const bool aInside = sa <= 0;
+            const bool bInside = sb <= 0;
+
+            if (aInside) {
+                vertices.push_back(a);
+                neighbors.push_back(cell.neighbors[i]);
+            }
+            if (aInside != bInside) {
+                const auto t = sa / (sa - sb);
+                vertices.push_back({a.x + t * (b.x - a.x),
+                                    a.y + t * (b.y - a.y)});
+                // Leaving the cell, the next edge runs along the clip line.
+                // Entering it, the rest of the original edge continues.
+                neighbors.push_back(aInside ? otherIndex : cell.neighbors[i]);
+            }
+        }
+
+        cell.vertices.swap(vertices);
+        cell.neighbors.swap(neighbors);
+    }
+}
 
-// Two groups: many centers around the edges, fewer centers inset in the
-// middle.
-std::vector<SDL_Point> randomCenters(int width, int height)
+std::vector<MapPoint> randomCenters(int width, int height, unsigned int seed)
 {
-    typedef std::uniform_int_distribution<int> RandDist;
-    std::vector<SDL_Point> centers;
+    std::minstd_rand randgen(seed);
+    std::vector<MapPoint> centers;
 
     const auto xInsetMin = static_cast<int>(width * 0.05);
     const auto xInsetMax = static_cast<int>(width * 0.95);
     const auto yInsetMin = static_cast<int>(height * 0.05);
     const auto yInsetMax = static_cast<int>(height * 0.95);
 
-    RandDist horizEdgeX(0, width - 1);
-    RandDist topEdgeY(0, yInsetMin);
-    RandDist bottomEdgeY(yInsetMax, height - 1);
+    RandRange horizEdgeX(0, width - 1);
+    RandRange topEdgeY(0, yInsetMin);
+    RandRange bottomEdgeY(yInsetMax, height - 1);
     for (int i = 0; i < 20; ++i) {
         const int x1 = horizEdgeX(randgen);
         const int x2 = horizEdgeX(randgen);
         const int y1 = topEdgeY(randgen);
         const int y2 = bottomEdgeY(randgen);
-        centers.push_back(SDL_Point{x1, y1});
-        centers.push_back(SDL_Point{x2, y2});
+        centers.push_back(MapPoint{x1, y1});
+        centers.push_back(MapPoint{x2, y2});
     }
 
-    RandDist leftEdgeX(0, xInsetMin);
-    RandDist rightEdgeX(xInsetMax, width - 1);
-    RandDist vertEdgeY(0, height - 1);
+    RandRange leftEdgeX(0, xInsetMin);
+    RandRange rightEdgeX(xInsetMax, width - 1);
+    RandRange vertEdgeY(0, height - 1);
     for (int i = 0; i < 10; ++i) {
         const int x1 = leftEdgeX(randgen);
         const int x2 = rightEdgeX(randgen);
         const int y1 = vertEdgeY(randgen);
         const int y2 = vertEdgeY(randgen);
-        centers.push_back(SDL_Point{x1, y1});
-        centers.push_back(SDL_Point{x2, y2});
+        centers.push_back(MapPoint{x1, y1});
+        centers.push_back(MapPoint{x2, y2});
     }
 
-    RandDist middleX(xInsetMin, xInsetMax);
-    RandDist middleY(yInsetMin, yInsetMax);
+    RandRange middleX(xInsetMin, xInsetMax);
+    RandRange middleY(yInsetMin, yInsetMax);
     for (int i = 0; i < 50; ++i) {
         const int x = middleX(randgen);
         const int y = middleY(randgen);
-        centers.push_back(SDL_Point{x, y});
+        centers.push_back(MapPoint{x, y});
     }
 
     return centers;
 }
+
+std::vector<VoronoiCell> makeVoronoi(const std::vector<MapPoint> &centers,
+                                     int width, int height)
+{
+    // Start each cell as the whole map and cut away everything closer to
+    // some other center.  This is O(n^2), which is fine for the number of
+    // regions a playable map has.
+    std::vector<VoronoiCell> cells;
+    const int n = centers.size();
+    for (int i = 0; i < n; ++i) {
+        VoronoiCell cell;
+        cell.center = centers[i];
+        cell.vertices = {{0.0, 0.0},
+                         {static_cast<double>(width), 0.0},
+                         {static_cast<double>(width),
+                          static_cast<double>(height)},
+                         {0.0, static_cast<double>(height)}};
+        cell.neighbors.assign(4, -1);
+
+        for (int j = 0; j < n && !cell.vertices.empty(); ++j) {
+            if (j == i) {
+                continue;
+            }
+            if (centers[j].x == centers[i].x && centers[j].y == centers[i].y) {
+                // Duplicate center, the first one gets the whole cell.
+                if (j < i) {
+                    cell.vertices.clear();
+                    cell.neighbors.clear();
+                }
+                continue;
+            }
+            clipCell(cell, centers[j], j);
+        }
+        cells.push_back(std::move(cell));
+    }
+
+    return cells;
+}
+
+RegionGraph graphFromVoronoi(const std::vector<VoronoiCell> &cells)
+{
+    const int n = cells.size();
+    std::vector<std::vector<int>> adjacency(n);
+    for (int i = 0; i < n; ++i) {
+        const auto &cell = cells[i];
+        const int numVerts = cell.vertices.size();
+        for (int v = 0; v < numVerts; ++v) {
+            const auto nbr = cell.neighbors[v];
+            const auto &a = cell.vertices[v];
+            const auto &b = cell.vertices[(v + 1) % numVerts];
+            if (nbr < 0 || std::hypot(b.x - a.x, b.y - a.y) < minEdgeLength) {
+                continue;
+            }
+
+            // Rounding can leave an edge on only one side, so add both
+            // directions and remove duplicates afterward.
+            adjacency[i].push_back(nbr);
+            adjacency[nbr].push_back(i);
+        }
+    }
+
+    for (auto &nbrs : adjacency) {
+        sort(std::begin(nbrs), std::end(nbrs));
+        nbrs.erase(unique(std::begin(nbrs), std::end(nbrs)), std::end(nbrs));
+    }
+    return RegionGraph{adjacency};
+}
+
+CellSpan cellSpan(const VoronoiCell &cell, double scale, int y)
+{
+    // Cells are convex, so a row crosses the boundary at most twice.
+    const auto rowY = (y + 0.5) * scale;
+    double xMin = 0.0;
+    double xMax = -1.0;
+    bool found = false;
+    const int n = cell.vertices.size();
+    for (int i = 0; i < n; ++i) {
+        const auto &a = cell.vertices[i];
+        const auto &b = cell.vertices[(i + 1) % n];
+        if ((a.y <= rowY && rowY < b.y) || (b.y <= rowY && rowY < a.y)) {
+            const auto x = a.x + (rowY - a.y) * (b.x - a.x) / (b.y - a.y);
+            xMin = found ? std::min(xMin, x) : x;
+            xMax = found ? std::max(xMax, x) : x;
+            found = true;
+        }
+    }
+    if (!found) {
+        return {0, 0};
+    }
+
+    return {static_cast<int>(std::ceil(xMin / scale - 0.5)),
+            static_cast<int>(std::ceil(xMax / scale - 0.5))};
+}
+
+std::vector<int> labelVoronoi(const std::vector<VoronoiCell> &cells,
+                              int width, int height)
+{
+    std::vector<int> labels(width * height, -1);
+    const int n = cells.size();
+    for (int r = 0; r < n; ++r) {
+        for (int y = 0; y < height; ++y) {
+            const auto span = cellSpan(cells[r], 1.0, y);
+            const int x1 = std::max(span.x1, 0);
+            const int x2 = std::min(span.x2, width);
+            if (x1 < x2) {
+                std::fill(&labels[y * width + x1], &labels[y * width + x2], r);
+            }
+        }
+    }
+
+    // Rounding can leave the odd pixel uncovered where cells meet.  Give it
+    // to the nearest center, which is what the diagram means anyway.
+    for (int y = 0, a = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x, ++a) {
+            if (labels[a] >= 0) {
+                continue;
+            }
+
+            double bestDist = -1.0;
+            for (int r = 0; r < n; ++r) {
+                const auto dx = x + 0.5 - cells[r].center.x;
+                const auto dy = y + 0.5 - cells[r].center.y;
+                const auto dist = dx * dx + dy * dy;
+                if (bestDist < 0 || dist < bestDist) {
+                    bestDist = dist;
+                    labels[a] = r;
+                }
+            }
+        }
+    }
+
+    return labels;
+}
@@ -0,0 +1,75 @@
+/*
+    Copyright (C) 2014-2015 by Michael Kristofik <kristo605@gmail.com>
+    Part of the influence-map project.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2
+    or at your option any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY.
+
+    See the COPYING.txt file for more details.
+*/
+#ifndef VORONOI_H
+#define VORONOI_H
+
+#include "RegionGraph.h"
+#include <vector>
+
+// Pixel coordinates on a map.  Same layout as SDL_Point, but this code has no
+// SDL dependency so headless tools can use it.
+struct MapPoint
+{
+    int x;
+    int y;
+};
+
+struct VoronoiVertex
+{
+    double x;
+    double y;
+};
+
+// One region of a Voronoi diagram: every point closer to its center than to
+// any other center, clipped to the map.  Always convex.
+struct VoronoiCell
+{
+    MapPoint center;
+    std::vector<VoronoiVertex> vertices;
+
+    // Region on the other side of the edge from vertices[i] to vertices[i+1]
+    // (wrapping around), or -1 for the edge of the map.
+    std::vector<int> neighbors;
+};
+
+// Pixels [x1, x2) of one row.  Empty if x1 >= x2.
+struct CellSpan
+{
+    int x1;
+    int x2;
+};
+
+
+// Two groups: many centers around the edges, fewer centers inset in the
+// middle.  The same seed always gives the same centers, whichever standard
+// library built it.
+std::vector<MapPoint> randomCenters(int width, int height, unsigned int seed);
+
+// Build the Voronoi diagram of 'centers' within a width x height map.  Cell i
+// belongs to centers[i].
+std::vector<VoronoiCell> makeVoronoi(const std::vector<MapPoint> &centers,
+                                     int width, int height);
+
+// Regions are neighbors if their cells share an edge.
+RegionGraph graphFromVoronoi(const std::vector<VoronoiCell> &cells);
+
+// Return the pixels of row 'y' covered by a cell, when the map is drawn
+// scaled down by 'scale'.  A pixel is covered if its center is inside the
+// cell.
+CellSpan cellSpan(const VoronoiCell &cell, double scale, int y);
+
+// Region number of every pixel of a full-size map, row by row.
+std::vector<int> labelVoronoi(const std::vector<VoronoiCell> &cells,
+                              int width, int height);
+
+#endif